@@ -0,0 +1,19 @@
+// Per-CPU utilization and system load, see getcpustats().
+// Load averages are fixed point with FSHIFT fraction bits.
+#define FSHIFT 11
+#define FIXED_1 (1 << FSHIFT)
+
+struct cpustat {
+  uint busy;                   // timer ticks spent running a process
+  uint idle;                   // timer ticks spent in scheduler()
+  uint intr;                   // thousandths of a tick in interrupt handlers
+  uint nintr;                  // interrupts taken
+  uint nswtch;                 // processes dispatched
+  uint nready;                 // length of this CPU's run queue
+};
+
+struct cpustats {
+  uint ncpu;
+  uint load[3];                // 1, 5 and 15 minute load averages
+  struct cpustat cpu[NCPU];
+};
@@ -4,6 +4,7 @@ struct file;
 struct inode;
 struct pipe;
 struct proc;
+struct seg;
 struct rtcdate;
 struct spinlock;
 struct sleeplock;
@@ -13,6 +14,10 @@ struct superblock;
 #ifdef CS333_P2
 struct uproc;
 #endif
+#ifdef CS333_P4
+struct schedlat;
+struct cpustats;
+#endif
 
 // bio.c
 void            binit(void);
@@ -31,6 +36,10 @@ void            do_shutdown(void);
 
 // exec.c
 int             exec(char*, char**);
+int             execload(char*, char**, pde_t**, uint*, uint*, uint*,
+                         struct seg*);
+void            segdup(struct seg*, struct seg*);
+void            segput(struct seg*);
 
 // file.c
 struct file*    filealloc(void);
@@ -74,6 +83,8 @@ void            ioapicinit(void);
 // kalloc.c
 char*           kalloc(void);
 void            kfree(char*);
+void            kref(char*);
+int             krefcount(char*);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
 
@@ -85,6 +96,7 @@ void            cmostime(struct rtcdate *r);
 int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
+void            lapicipi(int, int);
 void            lapicinit(void);
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
@@ -99,6 +111,13 @@ void            end_op();
 extern int      ismp;
 void            mpinit(void);
 
+// pcache.c
+void            pcacheinit(void);
+char*           pcacheget(struct inode*, uint, uint);
+char*           pcacheadd(struct inode*, uint, uint, char*);
+void            pcacherelease(char*);
+void            pcacheinval(struct inode*);
+
 // picirq.c
 void            picenable(int);
 void            picinit(void);
@@ -127,12 +146,22 @@ void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
+void            wakeup_one(void*);
 void            yield(void);
 
 #ifdef CS333_P2 
 int             getprocs(uint max, struct uproc *table);
 #endif
 #ifdef CS333_P3
+int             sleeptimeout(void*, struct spinlock*, uint);
+void            procwritebegin(struct proc*);
+int             clone(void(*)(void*), void*, void*);
+int             join(void**);
+int             spawn(char*, char**, int*);
+void            switchpgdir(pde_t*, uint);
+void            procwriteend(struct proc*);
+int             getprocsince(uint, struct uproc*, uint*);
+void            timertick(void);
 void						readydump(void);
 void						freedump(void);
 void						sleepdump(void);
@@ -142,6 +171,17 @@ void						zombiedump(void);
 #ifdef CS333_P4
 int						  setpriority(int pid, int priority);
 int							getpriority(int pid);
+int             getschedlat(int, struct schedlat*);
+void            cpustattick(void);
+int             setaffinity(int, uint);
+int             getaffinity(int);
+void            schedtick(void);
+int             setrt(int, int, int);
+#ifdef CS333_STRIDE
+int             settickets(int, int);
+int             gettickets(int);
+#endif
+int             getcpustats(struct cpustats*);
 #endif
 
 // swtch.S
@@ -202,7 +242,12 @@ int             deallocuvm(pde_t*, uint, uint);
 void            freevm(pde_t*);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
-pde_t*          copyuvm(pde_t*, uint);
+pde_t*          copyuvm(pde_t*, uint, int);
+int             cowfault(pde_t*, uint);
+int             lazyfault(struct proc*, uint);
+int             uvmtouch(struct proc*, uint, uint);
+void            lockfaults(void);
+void            unlockfaults(void);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
@@ -7,18 +7,82 @@
 #include "x86.h"
 #include "elf.h"
 
+#define ULIBPATH "/ulib"  // runtime library image
 
-int
-exec(char *path, char **argv)
+// Record the loadable segments of the ELF file ip, which must be
+// locked, in segs[*nseg...] for lazyfault() to page in; any beyond
+// NSEG are loaded into pgdir now.  Set *lo and *hi to the lowest
+// and highest addresses used, and *entry if it is not 0.  The
+// segments don't hold references to ip yet.
+static int
+loadsegs(struct inode *ip, pde_t *pgdir, struct seg *segs, int *nseg,
+         uint *lo, uint *hi, uint *entry)
 {
-  char *s, *last;
   int i, off;
-  uint argc, sz, sp, ustack[3+MAXARG+1];
   struct elfhdr elf;
-  struct inode *ip;
   struct proghdr ph;
-  pde_t *pgdir, *oldpgdir;
-  struct proc *curproc = myproc();
+
+  // Check ELF header
+  if(readi(ip, (char*)&elf, 0, sizeof(elf)) != sizeof(elf))
+    return -1;
+  if(elf.magic != ELF_MAGIC)
+    return -1;
+
+  *lo = KERNBASE;
+  *hi = 0;
+  for(i=0, off=elf.phoff; i<elf.phnum; i++, off+=sizeof(ph)){
+    if(readi(ip, (char*)&ph, off, sizeof(ph)) != sizeof(ph))
+      return -1;
+    if(ph.type != ELF_PROG_LOAD)
+      continue;
+    if(ph.memsz < ph.filesz)
+      return -1;
+    if(ph.vaddr + ph.memsz < ph.vaddr)
+      return -1;
+    if(ph.vaddr + ph.memsz >= KERNBASE)
+      return -1;
+    if(ph.vaddr % PGSIZE != 0)
+      return -1;
+    if(ph.memsz == 0)
+      continue;
+    if(*nseg < NSEG){
+      segs[*nseg].ip = ip;
+      segs[*nseg].va = ph.vaddr;
+      segs[*nseg].memsz = ph.memsz;
+      segs[*nseg].off = ph.off;
+      segs[*nseg].filesz = ph.filesz;
+      (*nseg)++;
+    } else {
+      if(allocuvm(pgdir, ph.vaddr, ph.vaddr + ph.memsz) == 0)
+        return -1;
+      if(loaduvm(pgdir, (char*)ph.vaddr, ip, ph.off, ph.filesz) < 0)
+        return -1;
+    }
+    if(ph.vaddr < *lo)
+      *lo = ph.vaddr;
+    if(ph.vaddr + ph.memsz > *hi)
+      *hi = ph.vaddr + ph.memsz;
+  }
+  if(entry)
+    *entry = elf.entry;
+  return 0;
+}
+
+// Set up the program at path in a new page table and push argv
+// on its stack.  Loadable segments are not read here: they are
+// recorded in segs (NSEG entries), each holding a reference to
+// its file, for lazyfault() to page in.  A program linked at
+// UPROGBASE gets the runtime library's segments below it.
+// On success set *pgdirp, *szp, *entryp, *spp and segs for the
+// new image and return 0.
+int
+execload(char *path, char **argv, pde_t **pgdirp, uint *szp,
+         uint *entryp, uint *spp, struct seg *segs)
+{
+  int i, nseg;
+  uint argc, sz, sp, lo, entry, liblo, libhi, ustack[3+MAXARG+1];
+  struct inode *ip, *lib;
+  pde_t *pgdir;
 
   begin_op();
 
@@ -31,35 +95,35 @@ exec(char *path, char **argv)
   }
   ilock(ip);
   pgdir = 0;
+  lib = 0;
+  nseg = 0;
+  memset(segs, 0, NSEG*sizeof(segs[0]));
 
-  // Check ELF header
-  if(readi(ip, (char*)&elf, 0, sizeof(elf)) != sizeof(elf))
-    goto bad;
-  if(elf.magic != ELF_MAGIC)
-    goto bad;
-
-  if((pgdir = setupkvm()) == 0)
+  if((pgdir = setupkvm()) == 0 ||
+     loadsegs(ip, pgdir, segs, &nseg, &lo, &sz, &entry) < 0){
+    iunlock(ip);
     goto bad;
+  }
+  iunlock(ip);
 
-  // Load program into memory.
-  sz = 0;
-  for(i=0, off=elf.phoff; i<elf.phnum; i++, off+=sizeof(ph)){
-    if(readi(ip, (char*)&ph, off, sizeof(ph)) != sizeof(ph))
-      goto bad;
-    if(ph.type != ELF_PROG_LOAD)
-      continue;
-    if(ph.memsz < ph.filesz)
-      goto bad;
-    if(ph.vaddr + ph.memsz < ph.vaddr)
-      goto bad;
-    if((sz = allocuvm(pgdir, sz, ph.vaddr + ph.memsz)) == 0)
-      goto bad;
-    if(ph.vaddr % PGSIZE != 0)
+  if(lo >= UPROGBASE){
+    // The program calls the runtime library through the jump
+    // table at the start of the library's image.
+    if((lib = namei(ULIBPATH)) == 0)
       goto bad;
-    if(loaduvm(pgdir, (char*)ph.vaddr, ip, ph.off, ph.filesz) < 0)
+    ilock(lib);
+    if(loadsegs(lib, pgdir, segs, &nseg, &liblo, &libhi, 0) < 0 ||
+       libhi > UPROGBASE){
+      iunlock(lib);
       goto bad;
+    }
+    iunlock(lib);
   }
-  iunlockput(ip);
+  for(i = 0; i < nseg; i++)
+    idup(segs[i].ip);
+  iput(ip);
+  if(lib)
+    iput(lib);
   end_op();
   ip = 0;
 
@@ -90,28 +154,99 @@ exec(char *path, char **argv)
   if(copyout(pgdir, sp, ustack, (3+argc+1)*4) < 0)
     goto bad;
 
+  *pgdirp = pgdir;
+  *szp = sz;
+  *entryp = entry;
+  *spp = sp;
+  return 0;
+
+bad:
+  if(pgdir)
+    freevm(pgdir);
+  if(ip){
+    iput(ip);
+    if(lib)
+      iput(lib);
+    end_op();
+  } else {
+    begin_op();
+    segput(segs);
+    end_op();
+  }
+  return -1;
+}
+
+int
+exec(char *path, char **argv)
+{
+  char *s, *last;
+  uint sz, sp, entry;
+  pde_t *pgdir;
+#ifndef CS333_P3
+  pde_t *oldpgdir;
+#endif
+  struct seg segs[NSEG], oldsegs[NSEG];
+  struct proc *curproc = myproc();
+
+  if(execload(path, argv, &pgdir, &sz, &entry, &sp, segs) < 0)
+    return -1;
+
   // Save program name for debugging.
   for(last=s=path; *s; s++)
     if(*s == '/')
       last = s+1;
+#ifdef CS333_P3
+  procwritebegin(curproc);
+#endif
   safestrcpy(curproc->name, last, sizeof(curproc->name));
+#ifdef CS333_P3
+  procwriteend(curproc);
+#endif
 
   // Commit to the user image.
+  curproc->tf->eip = entry;  // main
+  curproc->tf->esp = sp;
+  memmove(oldsegs, curproc->seg, sizeof(oldsegs));
+  memmove(curproc->seg, segs, sizeof(segs));
+#ifdef CS333_P3
+  // Other threads may still be using the old image.
+  curproc->isthread = 0;
+  switchpgdir(pgdir, sz);
+#else
   oldpgdir = curproc->pgdir;
   curproc->pgdir = pgdir;
   curproc->sz = sz;
-  curproc->tf->eip = elf.entry;  // main
-  curproc->tf->esp = sp;
   switchuvm(curproc);
   freevm(oldpgdir);
+#endif
+  begin_op();
+  segput(oldsegs);
+  end_op();
   return 0;
+}
 
-bad:
-  if(pgdir)
-    freevm(pgdir);
-  if(ip){
-    iunlockput(ip);
-    end_op();
+// Give dst its own references to the segments in src.
+void
+segdup(struct seg *dst, struct seg *src)
+{
+  int i;
+
+  for(i = 0; i < NSEG; i++){
+    dst[i] = src[i];
+    if(dst[i].ip)
+      idup(dst[i].ip);
   }
-  return -1;
+}
+
+// Drop the segments' file references.  Must be called
+// inside a transaction.
+void
+segput(struct seg *segs)
+{
+  int i;
+
+  for(i = 0; i < NSEG; i++)
+    if(segs[i].ip)
+      iput(segs[i].ip);
+  memset(segs, 0, NSEG*sizeof(segs[0]));
 }
@@ -8,6 +8,10 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "spinlock.h"
+#include "x86.h"
+
+#define NMAG     32  // most free pages cached per CPU
+#define MAGBATCH 16  // pages moved to or from kmem.freelist at once
 
 void freerange(void *vstart, void *vend);
 extern char end[]; // first address after kernel loaded from ELF file
@@ -17,10 +21,25 @@ struct run {
   struct run *next;
 };
 
+// Each CPU keeps a magazine of free pages that only it uses,
+// with interrupts off, so most kalloc() and kfree() calls
+// don't take kmem.lock.  A magazine is refilled from and
+// drained to the shared free list MAGBATCH pages at a time.
+struct mag {
+  struct run *freelist;
+  int n;
+};
+
 struct {
   struct spinlock lock;
   int use_lock;
   struct run *freelist;
+  struct mag mag[NCPU];
+  // References to each physical page, for pages shared
+  // copy-on-write between address spaces.  kfree() only
+  // frees a page when its last reference is dropped.
+  // Changed atomically, without kmem.lock.
+  volatile ushort ref[PHYSTOP >> PGSHIFT];
 } kmem;
 
 // Initialization happens in two phases.
@@ -48,32 +67,63 @@ freerange(void *vstart, void *vend)
 {
   char *p;
   p = (char*)PGROUNDUP((uint)vstart);
-  for(; p + PGSIZE <= (char*)vend; p += PGSIZE)
+  for(; p + PGSIZE <= (char*)vend; p += PGSIZE){
+    kmem.ref[V2P(p) >> PGSHIFT] = 1;
     kfree(p);
+  }
 }
 //PAGEBREAK: 21
-// Free the page of physical memory pointed at by v,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// Drop a reference to the page of physical memory pointed
+// at by v, which normally should have been returned by a
+// call to kalloc(), and free it if that was the last one.
+// (The exception is when initializing the allocator; see
+// kinit above.)
 void
 kfree(char *v)
 {
   struct run *r;
 
+  struct mag *m;
+  int i;
+
   if((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
     panic("kfree");
 
+  switch(xaddw(&kmem.ref[V2P(v) >> PGSHIFT], -1)){
+  case 0:
+    panic("kfree: free page");
+  case 1:
+    break;
+  default:
+    return;
+  }
+
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
   r = (struct run*)v;
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  if(kmem.use_lock)
+  if(!kmem.use_lock){
+    // Early boot: one CPU, and mycpu() doesn't work yet.
+    r->next = kmem.freelist;
+    kmem.freelist = r;
+    return;
+  }
+  pushcli();
+  m = &kmem.mag[cpuid()];
+  r->next = m->freelist;
+  m->freelist = r;
+  if(++m->n > NMAG){
+    acquire(&kmem.lock);
+    for(i = 0; i < MAGBATCH; i++){
+      r = m->freelist;
+      m->freelist = r->next;
+      r->next = kmem.freelist;
+      kmem.freelist = r;
+    }
+    m->n -= MAGBATCH;
     release(&kmem.lock);
+  }
+  popcli();
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -83,14 +133,50 @@ char*
 kalloc(void)
 {
   struct run *r;
+  struct mag *m;
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
-  r = kmem.freelist;
+  if(!kmem.use_lock){
+    r = kmem.freelist;
+    if(r)
+      kmem.freelist = r->next;
+  } else {
+    pushcli();
+    m = &kmem.mag[cpuid()];
+    if(m->n == 0){
+      acquire(&kmem.lock);
+      while(m->n < MAGBATCH && (r = kmem.freelist) != 0){
+        kmem.freelist = r->next;
+        r->next = m->freelist;
+        m->freelist = r;
+        m->n++;
+      }
+      release(&kmem.lock);
+    }
+    r = m->freelist;
+    if(r){
+      m->freelist = r->next;
+      m->n--;
+    }
+    popcli();
+  }
   if(r)
-    kmem.freelist = r->next;
-  if(kmem.use_lock)
-    release(&kmem.lock);
+    kmem.ref[V2P(r) >> PGSHIFT] = 1;
   return (char*)r;
 }
 
+// Take another reference to the page at v.
+void
+kref(char *v)
+{
+  if((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
+    panic("kref");
+  xaddw(&kmem.ref[V2P(v) >> PGSHIFT], 1);
+}
+
+// Number of references to the page at v.
+int
+krefcount(char *v)
+{
+  return kmem.ref[V2P(v) >> PGSHIFT];
+}
+
@@ -8,6 +8,10 @@
 #define KERNBASE 0x80000000         // First kernel virtual address
 #define KERNLINK (KERNBASE+EXTMEM)  // Address where kernel is linked
 
+// The user runtime library (_ulib) is linked at address 0 and
+// programs that call it above it, at UPROGBASE (see Makefile).
+#define UPROGBASE 0x8000
+
 #define V2P(a) (((uint) (a)) - KERNBASE)
 #define P2V(a) (((void *) (a)) + KERNBASE)
 
@@ -0,0 +1,192 @@
+// Program page cache.
+//
+// Pages of program files, keyed by (dev, inum, offset), so
+// that every process running the same program maps the same
+// physical pages.  The pages are mapped copy-on-write: text
+// stays shared, and a process that writes its data gets a
+// private copy from cowfault().
+//
+// Interface:
+// * lazyfault() calls pcacheget() for a page it is about to
+//     read from a program file, and offers the page it read
+//     to pcacheadd() on a miss, holding the inode lock across
+//     the read and the add.
+// * After unmapping a copy-on-write page, call pcacherelease()
+//     so the cache lets go of it once nobody maps it.
+// * writei() and itrunc() call pcacheinval() to drop the
+//     pages of a file whose contents change.
+//
+// Each entry holds a page reference of its own, on top of
+// the references of the page tables that map it.
+//
+// Entries are hashed by (dev, inum, off) into buckets of
+// NPCWAY entries, so lookups search one bucket.  slot[] maps
+// each physical page to its entry, and an inode's pcached flag
+// says whether it may have entries at all; pcacherelease() and
+// pcacheinval() check these first so that the common case, a
+// page or file that is not cached, skips pcache.lock.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+
+#define NPCWAY   8                    // entries per bucket
+#define NPCHASH  (NPCACHE / NPCWAY)
+
+struct pcentry {
+  uint dev;
+  uint inum;
+  uint off;      // file offset of the page
+  uint n;        // bytes read from the file; the rest is zero
+  char *page;    // 0 if the entry is free
+};
+
+struct {
+  struct spinlock lock;
+  struct pcentry e[NPCACHE];
+  // 1 + index in e[] of the entry holding each physical page,
+  // or 0.  Set and cleared under lock; read without it.
+  volatile ushort slot[PHYSTOP >> PGSHIFT];
+} pcache;
+
+void
+pcacheinit(void)
+{
+  initlock(&pcache.lock, "pcache");
+}
+
+static struct pcentry*
+pcachebucket(uint dev, uint inum, uint off)
+{
+  uint h;
+
+  h = ((dev * 31 + inum) * 17 + off / PGSIZE) % NPCHASH;
+  return &pcache.e[h * NPCWAY];
+}
+
+static struct pcentry*
+pcachefind(uint dev, uint inum, uint off, uint n)
+{
+  struct pcentry *b, *e;
+
+  b = pcachebucket(dev, inum, off);
+  for(e = b; e < &b[NPCWAY]; e++)
+    if(e->page && e->dev == dev && e->inum == inum &&
+       e->off == off && e->n == n)
+      return e;
+  return 0;
+}
+
+// Drop entry e and its page reference.  Caller holds lock.
+static void
+pcachedrop(struct pcentry *e)
+{
+  pcache.slot[V2P(e->page) >> PGSHIFT] = 0;
+  kfree(e->page);
+  e->page = 0;
+}
+
+// Return the cached page holding n bytes of ip at off, with a
+// reference for the caller, or 0 if it is not cached.
+char*
+pcacheget(struct inode *ip, uint off, uint n)
+{
+  struct pcentry *e;
+  char *page;
+
+  page = 0;
+  acquire(&pcache.lock);
+  if((e = pcachefind(ip->dev, ip->inum, off, n)) != 0){
+    page = e->page;
+    kref(page);
+  }
+  release(&pcache.lock);
+  return page;
+}
+
+// Offer page, just read from ip, to the cache.  Return the
+// page the caller should map copy-on-write, which may be one
+// another process cached first (page is then freed), or 0 if
+// the bucket is full and the caller should keep page private.
+// Caller must hold ip->lock.
+char*
+pcacheadd(struct inode *ip, uint off, uint n, char *page)
+{
+  struct pcentry *b, *e, *free;
+
+  acquire(&pcache.lock);
+  if((e = pcachefind(ip->dev, ip->inum, off, n)) != 0){
+    kref(e->page);
+    release(&pcache.lock);
+    kfree(page);
+    return e->page;
+  }
+  // Reuse a free entry or one whose page nobody maps.
+  b = pcachebucket(ip->dev, ip->inum, off);
+  free = 0;
+  for(e = b; e < &b[NPCWAY]; e++){
+    if(e->page == 0){
+      free = e;
+      break;
+    }
+    if(free == 0 && krefcount(e->page) == 1)
+      free = e;
+  }
+  if(free == 0){
+    release(&pcache.lock);
+    return 0;
+  }
+  if(free->page)
+    pcachedrop(free);
+  free->dev = ip->dev;
+  free->inum = ip->inum;
+  free->off = off;
+  free->n = n;
+  free->page = page;
+  kref(page);
+  pcache.slot[V2P(page) >> PGSHIFT] = free - pcache.e + 1;
+  ip->pcached = 1;
+  release(&pcache.lock);
+  return page;
+}
+
+// A mapping of page was just dropped.  If the cache holds
+// the only reference left, free the page.
+void
+pcacherelease(char *page)
+{
+  int i;
+
+  // A page is entered in slot[] before anyone maps it, so
+  // a page being unmapped cannot be entered concurrently.
+  if(pcache.slot[V2P(page) >> PGSHIFT] == 0)
+    return;
+  acquire(&pcache.lock);
+  i = pcache.slot[V2P(page) >> PGSHIFT];
+  if(i != 0 && krefcount(page) == 1)
+    pcachedrop(&pcache.e[i-1]);
+  release(&pcache.lock);
+}
+
+// Forget the cached pages of ip.  Processes that map them
+// keep their copies.  Caller must hold ip->lock.
+void
+pcacheinval(struct inode *ip)
+{
+  struct pcentry *e;
+
+  if(!ip->pcached)
+    return;
+  acquire(&pcache.lock);
+  for(e = pcache.e; e < &pcache.e[NPCACHE]; e++)
+    if(e->page && e->dev == ip->dev && e->inum == ip->inum)
+      pcachedrop(e);
+  ip->pcached = 0;
+  release(&pcache.lock);
+}
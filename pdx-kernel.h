@@ -41,4 +41,35 @@ lock_add(uint* mem, uint n)
   asm volatile("lock add %0, %1" : "=m" (mem) : "d" (n));
 }
 
+// set and clear bit in *mask atomically.
+static inline void
+atom_setbit(volatile uint *mask, int bit)
+{
+  asm volatile("lock btsl %1, %0" : "+m" (*mask) : "r" (bit) : "memory");
+}
+
+static inline void
+atom_clearbit(volatile uint *mask, int bit)
+{
+  asm volatile("lock btrl %1, %0" : "+m" (*mask) : "r" (bit) : "memory");
+}
+
+// enable interrupts and halt with no window for an interrupt
+// to slip in between: sti takes effect after the next instruction.
+static inline void
+sti_hlt()
+{
+  asm volatile("sti; hlt");
+}
+
+// index of the most significant set bit. mask must be non-zero.
+static inline int
+highbit(uint mask)
+{
+  int bit;
+
+  asm volatile("bsrl %1, %0" : "=r" (bit) : "rm" (mask));
+  return bit;
+}
+
 #endif  // PDX_KERNEL_INCLUDE
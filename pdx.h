@@ -31,6 +31,16 @@
 
 #ifdef CS333_P4
 #define MAXPRIO 4 //maxi priority level
+#define BUDGET 300 // ticks a process may run before it is demoted
+#define TICKS_TO_PROMOTE 3000 // ticks between promotions of every process
+#define QUANTA { 80, 40, 20, 10, 5 } // time slice in ticks, by priority
+#define MAXRTPERIOD (60*TPS) // longest real-time period in ticks
+#endif
+
+#ifdef CS333_STRIDE
+#define STRIDE1 (1 << 16) // stride of a process holding one ticket
+#define DEFTICKETS 100    // tickets of init, inherited across fork
+#define MAXTICKETS 10000
 #endif
 
 #endif  // PDX_INCLUDE
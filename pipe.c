@@ -84,15 +84,20 @@ pipewrite(struct pipe *p, char *addr, int n)
   for(i = 0; i < n; i++){
     while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
       if(p->readopen == 0 || myproc()->killed){
+        wakeup_one(&p->nwrite);  // pass our wakeup on
         release(&p->lock);
         return -1;
       }
-      wakeup(&p->nread);
+      wakeup_one(&p->nread);
       sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
     }
     p->data[p->nwrite++ % PIPESIZE] = addr[i];
   }
-  wakeup(&p->nread);  //DOC: pipewrite-wakeup1
+  wakeup_one(&p->nread);  //DOC: pipewrite-wakeup1
+  // Readers and writers are woken one at a time; leave room for
+  // the next writer to go on.
+  if(p->nwrite < p->nread + PIPESIZE)
+    wakeup_one(&p->nwrite);
   release(&p->lock);
   return n;
 }
@@ -105,6 +110,7 @@ piperead(struct pipe *p, char *addr, int n)
   acquire(&p->lock);
   while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
     if(myproc()->killed){
+      wakeup_one(&p->nread);  // pass our wakeup on
       release(&p->lock);
       return -1;
     }
@@ -115,7 +121,10 @@ piperead(struct pipe *p, char *addr, int n)
       break;
     addr[i] = p->data[p->nread++ % PIPESIZE];
   }
-  wakeup(&p->nwrite);  //DOC: piperead-wakeup
+  wakeup_one(&p->nwrite);  //DOC: piperead-wakeup
+  // Leave what we didn't take for the next reader.
+  if(p->nread != p->nwrite)
+    wakeup_one(&p->nread);
   release(&p->lock);
   return i;
 }
@@ -11,8 +11,27 @@
 #include "uproc.h"
 #endif
 
+#ifdef CS333_P4
+#include "schedlat.h"
+#include "cpustat.h"
+#include "traps.h"
+#endif
+
 #ifdef CS333_P3
 #define statecount NELEM(states)
+// SLEEPING processes are kept in NSLEEPQ wait queues hashed by channel.
+// SLEEPQ() is a multiplicative hash keeping the top 5 bits.
+#define NSLEEPQ 32
+#define SLEEPQ(chan) ((((uint)(chan)) * 2654435761U) >> 27)
+// Timed sleepers are also hashed by deadline into a wheel of
+// NTIMERSLOT one-tick slots, see timertick().
+#define NTIMERSLOT 64
+// Allocated processes are hashed by pid for findproc().  Pids are
+// handed out sequentially, so the low bits spread them evenly.
+#define NPIDHASH 64
+#define PIDHASH(pid) ((uint)(pid) & (NPIDHASH - 1))
+// Pids of the last NEXITED processes reaped, for getprocsince().
+#define NEXITED 64
 #endif
 
 static char *states[] = {
@@ -34,20 +53,74 @@ struct ptrs {
 };
 #endif
 
+#ifdef CS333_P4
+// Per-CPU run queue.  A RUNNABLE process sits on the ready list for
+// its priority in the queue of the CPU it last ran on, see p->cpu.
+// With CS333_STRIDE the queue is instead a min-heap on p->pass.
+// ptable.nrunnable[] counts what each CPU may run across all queues.
+//
+// Locking: each queue has its own lock.  A process enters or leaves
+// a queue only on a state change, which is made under ptable.lock,
+// so changing a queue takes ptable.lock and then the queue's lock.
+// Reading a queue, e.g. readydump(), takes only the queue's lock.
+// Lock order is ptable.lock, then at most one queue lock; never take
+// ptable.lock or a second queue lock while holding a queue lock.
+// Stealing locks each victim queue in turn while it looks; the
+// process it picks stays queued until the stealer, which holds
+// ptable.lock, removes it.
+struct runq {
+  struct spinlock lock;
+#ifdef CS333_STRIDE
+  struct proc *heap[NPROC];    // heap[0] has the lowest pass
+  uint vtime;                  // pass of the last process dispatched
+#else
+  struct ptrs ready[MAXPRIO + 1];
+  uint readymask;              // bit i set iff ready[i] is non-empty
+#endif
+  volatile int nready;         // number of processes on this queue
+};
+#endif
+
 static struct {
   struct spinlock lock;
   struct proc proc[NPROC];
   #ifdef CS333_P3
   struct ptrs list[statecount];
+  struct ptrs sleepq[NSLEEPQ];  // SLEEPING procs, by SLEEPQ(p->chan)
+  struct proc *wheel[NTIMERSLOT]; // timed sleepers, by p->wakeat
+  volatile int ntimers;        // number of procs on the wheel
+  uint wheeltime;              // last tick the wheel was advanced to
+  struct proc *pidhash[NPIDHASH]; // allocated procs, by PIDHASH(p->pid)
+  struct {
+    uint pid;
+    uint gen;
+  } exited[NEXITED];           // ring of reaped pids
+  volatile uint nexited;       // number of pids ever put on the ring
+  volatile uint exitseq;       // odd while exited[] is being changed
   #endif
 
   #ifdef CS333_P4
-  struct ptrs ready[MAXPRIO + 1];
+  struct runq rq[NCPU];
+  volatile uint idlemask;      // bit c set while CPU c is halted
+  volatile int nrunnable[NCPU]; // queued procs CPU c may run, see runnableFor()
   uint PromoteAtTime;
+  uint loadavg[3];             // see cpustattick()
+  struct ptrs rtready;         // eligible RT procs, earliest deadline first
+  struct ptrs rtthrottled;     // RT procs out of budget until rtdeadline
+  volatile int nrt;            // number of procs on rtready
+  uint rtutil;                 // sum of RT budget/period, per mille
+  struct schedlat lat[NPROC];  // per process, indexed like proc[]
+  struct schedlat priolat[MAXPRIO + 1]; // by priority when dispatched
   #endif
 
 } ptable;
 
+#if defined(CS333_P4) && !defined(CS333_STRIDE)
+// Time slice by priority: short for interactive levels, long for
+// batch ones.  See QUANTA in pdx.h.
+static int quantum[MAXPRIO + 1] = QUANTA;
+#endif
+
 // list management function prototypes
 #ifdef CS333_P3
 static void initProcessLists(void);
@@ -55,6 +128,39 @@ static void initFreeList(void);
 static void stateListAdd(struct ptrs*, struct proc*);
 static int  stateListRemove(struct ptrs*, struct proc* p);
 static void assertState(struct proc*, enum procstate, const char *, int);
+static void readyListAdd(struct proc*);
+static int  readyListRemove(struct proc*);
+static void sleepListAdd(struct proc*);
+static int  sleepListRemove(struct proc*);
+static void timerAdd(struct proc*, uint);
+static void timerRemove(struct proc*);
+static void wakeproc(struct proc*);
+static void childAdd(struct proc**, struct proc*);
+static int  forkcommit(struct proc*, struct proc*);
+static void forkfiles(struct proc*, struct proc*);
+static uint reap(struct proc*, struct proc*);
+static int  vmshared(pde_t*);
+static void childRemove(struct proc**, struct proc*);
+static void seqBegin(struct proc*);
+static void seqEnd(struct proc*);
+static void exitedAdd(uint pid, uint gen);
+static void pidHashAdd(struct proc*);
+static void pidHashRemove(struct proc*);
+static struct proc* findproc(int pid);
+#endif
+
+#ifdef CS333_P4
+static struct proc* readyListPick(int cpu);
+static int  runnableWaiting(int);
+static void runnableFor(struct proc*, int);
+static void updateBudget(struct proc*);
+#ifndef CS333_STRIDE
+static void promoteAll(void);
+#endif
+static void latRecord(struct proc*);
+static void kickIdle(struct proc*);
+static void rtReadyAdd(struct proc*);
+static int  rtReadyRemove(struct proc*);
 #endif
 
 static struct proc *initproc;
@@ -145,6 +251,7 @@ allocproc(void)
   
   #ifdef CS333_P3
   stateListAdd(&ptable.list[EMBRYO],p);
+  pidHashAdd(p);
   #endif
 
 
@@ -152,6 +259,28 @@ allocproc(void)
   p->cpu_ticks_total = 0;
   p->cpu_ticks_in = 0;
   #endif 
+
+  p->tslot = -1;
+  p->isthread = 0;
+  p->children = 0;
+  p->zombies = 0;
+
+  #ifdef CS333_P4
+  memset(&ptable.lat[p - ptable.proc], 0, sizeof(struct schedlat));
+  p->woken = 0;
+  p->readyat = ticks;
+  p->affinity = ~0;
+  p->rtperiod = 0;
+  p->rtutil = 0;
+  #ifdef CS333_STRIDE
+  p->tickets = DEFTICKETS;
+  p->stride = STRIDE1 / DEFTICKETS;
+  p->pass = 0;
+  p->heapidx = -1;
+  #endif
+  p->priority = MAXPRIO;
+  p->budget = BUDGET;
+  #endif
   
   release(&ptable.lock);
 
@@ -168,6 +297,8 @@ allocproc(void)
 
     #ifdef CS333_P3
     stateListAdd(&ptable.list[UNUSED], p);
+    pidHashRemove(p);
+    release(&ptable.lock);
     #endif
 
     return 0;
@@ -290,14 +421,60 @@ userinit(void)
 
   p->state = RUNNABLE;
 
+  #ifdef CS333_P4
+  p->cpu = 0;
+  #endif
   #ifdef CS333_P3
-  stateListAdd(&ptable.list[RUNNABLE],p);
+  readyListAdd(p);
   #endif
   release(&ptable.lock);
 }
 
 // Grow current process's memory by n bytes.
 // Return 0 on success, -1 on failure.
+#ifdef CS333_P3
+// Threads share the address space, so growth is done under
+// ptable.lock and every thread sees the new size.  A process with
+// threads may not shrink: other CPUs could still reach the freed
+// pages through their TLBs.  The size changes under the fault lock
+// so lazyfault() never maps a page above it.
+int
+growproc(int n)
+{
+  uint sz;
+  struct proc *p, *curproc = myproc();
+
+  acquire(&ptable.lock);
+  sz = curproc->sz;
+  if(n > 0){
+    // Pages are allocated by lazyfault() when first touched.
+    if(sz + n < sz || sz + n >= KERNBASE){
+      release(&ptable.lock);
+      return -1;
+    }
+    sz += n;
+  } else if(n < 0 && vmshared(curproc->pgdir) > 1){
+    release(&ptable.lock);
+    return -1;
+  }
+  lockfaults();
+  if(n < 0 && (sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0){
+    unlockfaults();
+    release(&ptable.lock);
+    return -1;
+  }
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state != UNUSED && p->pgdir == curproc->pgdir){
+      seqBegin(p);
+      p->sz = sz;
+      seqEnd(p);
+    }
+  unlockfaults();
+  release(&ptable.lock);
+  switchuvm(curproc);
+  return 0;
+}
+#else
 int
 growproc(int n)
 {
@@ -306,8 +483,10 @@ growproc(int n)
 
   sz = curproc->sz;
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    // Pages are allocated by lazyfault() when first touched.
+    if(sz + n < sz || sz + n >= KERNBASE)
       return -1;
+    sz += n;
   } else if(n < 0){
     if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
       return -1;
@@ -316,6 +495,8 @@ growproc(int n)
   switchuvm(curproc);
   return 0;
 }
+#endif
+
 // Create a new process copying p as the parent.
 // Sets up stack to return as if from system call.
 // Caller must set state of returned proc to RUNNABLE.
@@ -323,18 +504,22 @@ growproc(int n)
 int
 fork(void)
 {
-  int i;
-  uint pid;
   struct proc *np;
   struct proc *curproc = myproc();
+  int cow;
 
   // Allocate process.
   if((np = allocproc()) == 0){
     return -1;
   }
 
-  // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
+  // Copy process state from proc.  A process with threads
+  // gets an eager copy: the others may be writing through
+  // TLB entries that copy-on-write can't take away.
+  acquire(&ptable.lock);
+  cow = vmshared(curproc->pgdir) == 1;
+  release(&ptable.lock);
+  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz, cow)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
     #ifdef CS333_P3
@@ -348,6 +533,7 @@ fork(void)
 
     #ifdef CS333_P3
     stateListAdd(&ptable.list[UNUSED], np);
+    pidHashRemove(np);
     release(&ptable.lock);
     #endif
     return -1;
@@ -359,12 +545,135 @@ fork(void)
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
 
+  forkfiles(np, curproc);
+  return forkcommit(np, curproc);
+}
+
+// Clone a thread of the current process that shares its address
+// space and runs fn(arg) on the PGSIZE byte stack at stack.
+int
+clone(void (*fn)(void*), void *arg, void *stack)
+{
+  struct proc *np;
+  struct proc *curproc = myproc();
+  uint sp, ustack[2];
+
+  if((uint)stack + PGSIZE > curproc->sz || (uint)stack + PGSIZE < (uint)stack)
+    return -1;
+  if((np = allocproc()) == 0)
+    return -1;
+
+  acquire(&ptable.lock);
+  np->pgdir = curproc->pgdir;
+  np->sz = curproc->sz;
+  release(&ptable.lock);
+  np->parent = curproc;
+  np->isthread = 1;
+  np->ustack = stack;
+  *np->tf = *curproc->tf;
+
+  // fn returns to a fake PC; a thread must call exit().
+  sp = (uint)stack + PGSIZE;
+  ustack[0] = 0xffffffff;
+  ustack[1] = (uint)arg;
+  sp -= sizeof(ustack);
+  if(copyout(np->pgdir, sp, ustack, sizeof(ustack)) < 0){
+    // Out of memory for the stack page, or it could not be
+    // read in.
+    kfree(np->kstack);
+    np->kstack = 0;
+    acquire(&ptable.lock);
+    if(stateListRemove(&ptable.list[EMBRYO], np) == -1){
+      panic("no np->state");
+    }
+    assertState(np, EMBRYO, __FUNCTION__, __LINE__);
+    np->pgdir = 0;
+    np->state = UNUSED;
+    stateListAdd(&ptable.list[UNUSED], np);
+    pidHashRemove(np);
+    release(&ptable.lock);
+    return -1;
+  }
+  np->tf->esp = sp;
+  np->tf->eip = (uint)fn;
+  np->tf->eax = 0;
+
+  forkfiles(np, curproc);
+  return forkcommit(np, curproc);
+}
+
+// Start the program at path with arguments argv in a new child
+// process, building it straight from the ELF file instead of
+// copying the caller.  If fdmap is non-zero, the child's file
+// descriptor i is the caller's fdmap[i], or closed if that is
+// not an open file; otherwise the child gets all of them.
+int
+spawn(char *path, char **argv, int *fdmap)
+{
+  struct proc *np;
+  struct proc *curproc = myproc();
+  pde_t *pgdir;
+  uint sz, entry, sp;
+  struct seg segs[NSEG];
+  char *s, *last;
+  int i, fd;
+
+  if(execload(path, argv, &pgdir, &sz, &entry, &sp, segs) < 0)
+    return -1;
+  if((np = allocproc()) == 0){
+    freevm(pgdir);
+    begin_op();
+    segput(segs);
+    end_op();
+    return -1;
+  }
+  np->pgdir = pgdir;
+  np->sz = sz;
+  memmove(np->seg, segs, sizeof(segs));
+  np->parent = curproc;
+  memset(np->tf, 0, sizeof(*np->tf));
+  np->tf->cs = (SEG_UCODE << 3) | DPL_USER;
+  np->tf->ds = (SEG_UDATA << 3) | DPL_USER;
+  np->tf->es = np->tf->ds;
+  np->tf->ss = np->tf->ds;
+  np->tf->eflags = FL_IF;
+  np->tf->esp = sp;
+  np->tf->eip = entry;
+
+  for(i = 0; i < NOFILE; i++){
+    fd = fdmap ? fdmap[i] : i;
+    if(fd >= 0 && fd < NOFILE && curproc->ofile[fd])
+      np->ofile[i] = filedup(curproc->ofile[fd]);
+  }
+  np->cwd = idup(curproc->cwd);
+  for(last=s=path; *s; s++)
+    if(*s == '/')
+      last = s+1;
+  safestrcpy(np->name, last, sizeof(np->name));
+
+  return forkcommit(np, curproc);
+}
+
+// Give np copies of curproc's open files, directory and name.
+static void
+forkfiles(struct proc *np, struct proc *curproc)
+{
+  int i;
+
   for(i = 0; i < NOFILE; i++)
     if(curproc->ofile[i])
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
+  segdup(np->seg, curproc->seg);
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+}
+
+// Make the new child np of curproc RUNNABLE.
+static int
+forkcommit(struct proc *np, struct proc *curproc)
+{
+  uint pid;
 
   pid = np->pid;
 
@@ -377,8 +686,21 @@ fork(void)
   #endif
   np->state = RUNNABLE;
 
+  #ifdef CS333_P4
+  // Queue the child on this CPU; an idle CPU will steal it if need be.
+  pushcli();
+  np->cpu = cpuid();
+  popcli();
+  np->affinity = curproc->affinity;
+  #ifdef CS333_STRIDE
+  np->tickets = curproc->tickets;
+  np->stride = curproc->stride;
+  #endif
+  np->readyat = ticks;
+  #endif
   #ifdef CS333_P3
-  stateListAdd(&ptable.list[RUNNABLE], np);
+  readyListAdd(np);
+  childAdd(&curproc->children, np);
   #endif
 
   #ifdef CS333_P2
@@ -406,7 +728,7 @@ fork(void)
   }
 
   // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
+  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz, 1)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
     np->state = UNUSED;
@@ -423,6 +745,7 @@ fork(void)
     if(curproc->ofile[i])
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
+  segdup(np->seg, curproc->seg);
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
@@ -466,6 +789,7 @@ exit(void)
 
   begin_op();
   iput(curproc->cwd);
+  segput(curproc->seg);
   end_op();
   curproc->cwd = 0;
 
@@ -475,24 +799,35 @@ exit(void)
   wakeup1(curproc->parent);
 
   // Pass abandoned children to init.
-
-
-  // we know the order of the procstate enum. 
-  //0       1         2         3         4         5
-  //UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE
- 
-
-  for(int i = 1; i <= 5; i++) {
-    for(p=ptable.list[i].head; p; p=p->next){
-      if(p->parent == curproc){
-        p->parent = initproc;
-        if(p->state == ZOMBIE)
-          wakeup1(initproc);
-      }
+  while((p = curproc->children) != 0){
+    childRemove(&curproc->children, p);
+    seqBegin(p);
+    p->parent = initproc;
+    seqEnd(p);
+    childAdd(&initproc->children, p);
+  }
+  if(curproc->zombies){
+    while((p = curproc->zombies) != 0){
+      childRemove(&curproc->zombies, p);
+      seqBegin(p);
+      p->parent = initproc;
+      seqEnd(p);
+      childAdd(&initproc->zombies, p);
     }
+    wakeup1(initproc);
   }
 
+  #ifdef CS333_P4
+  if(curproc->rtperiod){
+    ptable.rtutil -= curproc->rtutil;
+    curproc->rtutil = 0;
+    curproc->rtperiod = 0;
+  }
+  #endif
 
+  // Queue ourselves for the parent's wait().
+  childRemove(&curproc->parent->children, curproc);
+  childAdd(&curproc->parent->zombies, curproc);
 
   // Jump into the scheduler, never to return.
   #ifdef CS333_P3
@@ -502,14 +837,14 @@ exit(void)
   #endif
 
   curproc->state = ZOMBIE;
+#ifdef PDX_XV6
+  curproc->sz = 0;
+#endif // PDX_XV6
 
   #ifdef CS333_P3
   stateListAdd(&ptable.list[ZOMBIE], curproc);
   #endif
 
-#ifdef PDX_XV6
-  curproc->sz = 0;
-#endif // PDX_XV6
   sched();
   panic("zombie exit");
 }
@@ -534,6 +869,7 @@ exit(void)
 
   begin_op();
   iput(curproc->cwd);
+  segput(curproc->seg);
   end_op();
   curproc->cwd = 0;
 
@@ -568,46 +904,29 @@ exit(void)
 int
 wait(void)
 {
-  struct proc *p;
+  struct proc *p, *next;
   int havekids;
   uint pid;
   struct proc *curproc = myproc();
 
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for exited children.
+    // exit() queues exited children on curproc->zombies.  Threads
+    // are left for join(), except orphans passed to init.
+    for(p = curproc->zombies; p; p = next){
+      next = p->sibnext;
+      if(p->isthread && curproc != initproc)
+        continue;
+      pid = reap(curproc, p);
+      if(p->isthread)
+        continue;
+      release(&ptable.lock);
+      return pid;
+    }
     havekids = 0;
-    for(int i = 1; i <= 5; i++){
-      for(p=ptable.list[i].head; p; p=p->next){
-        if(p->parent != curproc)
-          continue;
+    for(p = curproc->children; p; p = p->sibnext)
+      if(!p->isthread || curproc == initproc)
         havekids = 1;
-        if(p->state == ZOMBIE){
-          // Found one.
-          pid = p->pid;
-          kfree(p->kstack);
-          p->kstack = 0;
-          freevm(p->pgdir);
-          p->pid = 0;
-          p->parent = 0;
-          p->name[0] = 0;
-          p->killed = 0;
-          
-          #ifdef CS333_P3
-          if(stateListRemove(&ptable.list[ZOMBIE],p) == -1)
-            panic("no item in ZOMBIE list");
-          assertState(p, ZOMBIE, __FUNCTION__, __LINE__);
-          #endif 
-          p->state = UNUSED;
-          #ifdef CS333_P3
-          stateListAdd(&ptable.list[UNUSED], p);
-          #endif
-
-          release(&ptable.lock);
-          return pid;
-        }
-      }
-    }
 
     // No point waiting if we don't have any children.
     if(!havekids || curproc->killed){
@@ -620,6 +939,104 @@ wait(void)
   }
 }
 
+// Wait for a thread made by clone() to exit and return its pid,
+// setting *stack to the stack it was given.  Return -1 if this
+// process has no threads.
+int
+join(void **stack)
+{
+  struct proc *p;
+  int havethreads;
+  uint pid;
+  struct proc *curproc = myproc();
+
+  acquire(&ptable.lock);
+  for(;;){
+    for(p = curproc->zombies; p; p = p->sibnext)
+      if(p->isthread){
+        *stack = p->ustack;
+        pid = reap(curproc, p);
+        release(&ptable.lock);
+        return pid;
+      }
+    havethreads = 0;
+    for(p = curproc->children; p; p = p->sibnext)
+      if(p->isthread)
+        havethreads = 1;
+    if(!havethreads || curproc->killed){
+      release(&ptable.lock);
+      return -1;
+    }
+    sleep(curproc, &ptable.lock);
+  }
+}
+
+// Free zombie child p of curproc and return its pid.  The address
+// space goes with the last process using it.  The ptable lock must
+// be held.
+static uint
+reap(struct proc *curproc, struct proc *p)
+{
+  uint pid;
+
+  childRemove(&curproc->zombies, p);
+  pidHashRemove(p);
+  if(stateListRemove(&ptable.list[ZOMBIE],p) == -1)
+    panic("no item in ZOMBIE list");
+  assertState(p, ZOMBIE, __FUNCTION__, __LINE__);
+  pid = p->pid;
+  kfree(p->kstack);
+  p->kstack = 0;
+  p->state = UNUSED;
+  if(!vmshared(p->pgdir))
+    freevm(p->pgdir);
+  p->pgdir = 0;
+  p->pid = 0;
+  p->parent = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  stateListAdd(&ptable.list[UNUSED], p);
+  exitedAdd(pid, p->gen);
+  return pid;
+}
+
+// Number of allocated processes using pgdir.  The ptable lock
+// must be held.
+static int
+vmshared(pde_t *pgdir)
+{
+  struct proc *p;
+  int n;
+
+  n = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state != UNUSED && p->pgdir == pgdir)
+      n++;
+  return n;
+}
+
+// Switch the current process to a new address space and free the
+// old one unless other threads still use it.
+void
+switchpgdir(pde_t *pgdir, uint sz)
+{
+  struct proc *curproc = myproc();
+  pde_t *oldpgdir;
+  int shared;
+
+  acquire(&ptable.lock);
+  oldpgdir = curproc->pgdir;
+  curproc->pgdir = pgdir;
+  seqBegin(curproc);
+  curproc->sz = sz;
+  seqEnd(curproc);
+  shared = vmshared(oldpgdir);
+  release(&ptable.lock);
+  switchuvm(curproc);
+  if(!shared)
+    freevm(oldpgdir);
+}
+
 #else
 int
 wait(void)
@@ -674,7 +1091,95 @@ wait(void)
 //  - swtch to start running that process
 //  - eventually that process transfers control
 //      via swtch back to the scheduler.
-#ifdef CS333_P3
+#ifdef CS333_P4
+void
+scheduler(void)
+{
+  struct proc *p;
+  struct cpu *c = mycpu();
+  int cpu = c - cpus;
+  c->proc = 0;
+#ifdef PDX_XV6
+  int idle;  // for checking if processor is idle
+#endif // PDX_XV6
+
+  for(;;){
+    // Enable interrupts on this processor.
+    sti();
+
+#ifdef PDX_XV6
+    idle = 1;  // assume idle unless we schedule a process
+#endif // PDX_XV6
+    // Peek at the run queues first so an idle CPU never takes
+    // ptable.lock just to find nothing it may run.
+    if(!runnableWaiting(cpu))
+      p = 0;
+    else {
+      acquire(&ptable.lock);
+#ifndef CS333_STRIDE
+      if(ticks >= ptable.PromoteAtTime){
+        promoteAll();
+        ptable.PromoteAtTime = ticks + TICKS_TO_PROMOTE;
+      }
+#endif
+      // Take the best process on this CPU's queue, or steal one.
+      if((p = readyListPick(cpuid())) == 0)
+        release(&ptable.lock);
+    }
+    if(p){
+      // Switch to chosen process.  It is the process's job
+      // to release ptable.lock and then reacquire it
+      // before jumping back to us.
+#ifdef PDX_XV6
+      idle = 0;  // not idle this timeslice
+#endif // PDX_XV6
+      c->proc = p;
+      switchuvm(p);
+      if(readyListRemove(p) == -1)
+        panic("no item in ready list");
+      assertState(p, RUNNABLE, __FUNCTION__, __LINE__);
+      p->state = RUNNING;
+      p->cpu = cpuid();
+      c->resched = 0;
+#ifdef CS333_STRIDE
+      p->slice = SCHED_INTERVAL;
+#else
+      p->slice = quantum[p->priority];
+#endif
+#ifdef CS333_STRIDE
+      acquire(&ptable.rq[p->cpu].lock);
+      ptable.rq[p->cpu].vtime = p->pass;
+      release(&ptable.rq[p->cpu].lock);
+#endif
+      p->cpu_ticks_in = ticks;
+      stateListAdd(&ptable.list[RUNNING], p);
+      latRecord(p);
+      c->nswtch++;
+      swtch(&(c->scheduler), p->context);
+      switchkvm();
+
+      // Process is done running for now.
+      // It should have changed its p->state before coming back.
+      c->proc = 0;
+      release(&ptable.lock);
+    }
+#ifdef PDX_XV6
+    // If idle, advertise it in ptable.idlemask and wait for the
+    // next interrupt; readyListAdd() sends T_WAKEUP to an idle CPU.
+    // Recheck with interrupts off so a wakeup can't be missed.
+    if (idle) {
+      cli();
+      atom_setbit(&ptable.idlemask, cpuid());
+      if(runnableWaiting(cpu))
+        sti();
+      else
+        sti_hlt();
+      atom_clearbit(&ptable.idlemask, cpuid());
+    }
+#endif // PDX_XV6
+  }
+}
+#elif defined(CS333_P3)
 void
 scheduler(void)
 {
@@ -708,19 +1213,19 @@ scheduler(void)
 
       switchuvm(p);
       #ifdef CS333_P3
-      if(stateListRemove(&ptable.list[RUNNABLE],p) == -1)
+      if(readyListRemove(p) == -1)
         panic("no item in RUNNING list");
       assertState(p, RUNNABLE, __FUNCTION__, __LINE__);
       #endif 
       p->state = RUNNING;
+      #ifdef CS333_P2
+      p->cpu_ticks_in = ticks;
+      #endif
 
       #ifdef CS333_P3
       stateListAdd(&ptable.list[RUNNING], p);
       #endif
 
-      #ifdef CS333_P2
-      p->cpu_ticks_in = ticks;
-      #endif
       swtch(&(c->scheduler), p->context);
       switchkvm();
 
@@ -817,9 +1322,15 @@ sched(void)
   if(readeflags()&FL_IF)
     panic("sched interruptible");
   intena = mycpu()->intena;
+  #ifdef CS333_P3
+  seqBegin(p);
+  #endif
   #ifdef CS333_P2
   p->cpu_ticks_total += ticks - p->cpu_ticks_in;
   #endif
+  #ifdef CS333_P3
+  seqEnd(p);
+  #endif
   swtch(&p->context, mycpu()->scheduler);
   mycpu()->intena = intena;
 }
@@ -837,9 +1348,14 @@ yield(void)
     panic("no item in RUNNING list");
 	assertState(curproc, RUNNING, __FUNCTION__, __LINE__);
   #endif
+  #ifdef CS333_P4
+  updateBudget(curproc);
+  curproc->woken = 0;
+  curproc->readyat = ticks;
+  #endif
   curproc->state = RUNNABLE;
   #ifdef CS333_P3
-  stateListAdd(&ptable.list[RUNNABLE], curproc);
+  readyListAdd(curproc);
   #endif
 
   sched();
@@ -884,8 +1400,18 @@ forkret(void)
 #ifdef CS333_P3
 void
 sleep(void *chan, struct spinlock *lk)
+{
+  sleeptimeout(chan, lk, 0);
+}
+
+// Like sleep(), but also give up once nticks ticks have passed.
+// nticks of 0 means no timeout.  Returns -1 if the timeout expired,
+// 0 if woken by wakeup() or kill().
+int
+sleeptimeout(void *chan, struct spinlock *lk, uint nticks)
 {
   struct proc *p = myproc();
+  int timedout;
 
   if(p == 0)
     panic("sleep");
@@ -906,22 +1432,28 @@ sleep(void *chan, struct spinlock *lk)
     panic("no item in RUNNING list");
 	assertState(p, RUNNING, __FUNCTION__, __LINE__);
   #endif
+  #ifdef CS333_P4
+  updateBudget(p);
+  #endif
   p->chan = chan;
   p->state = SLEEPING;
-  #ifdef CS333_P3
-  stateListAdd(&ptable.list[SLEEPING], p);
-  #endif
+  sleepListAdd(p);
+  p->timedout = 0;
+  if(nticks)
+    timerAdd(p, ticks + nticks);
 
   sched();
 
   // Tidy up.
   p->chan = 0;
+  timedout = p->timedout;
 
   // Reacquire original lock.
   if(lk != &ptable.lock){  //DOC: sleeplock2
     release(&ptable.lock);
     if (lk) acquire(lk);
   }
+  return timedout ? -1 : 0;
 }
 #else
 void
@@ -963,23 +1495,16 @@ sleep(void *chan, struct spinlock *lk)
 // Wake up all processes sleeping on chan.
 // The ptable lock must be held.
 #ifdef CS333_P3
+// Only the wait queue chan hashes to is searched.
 static void
 wakeup1(void *chan)
 {
-  struct proc *p;
+  struct proc *p, *next;
 
-  for(p=ptable.list[SLEEPING].head; p; p=p->next){
-    if(p->state == SLEEPING && p->chan == chan){
-      #ifdef CS333_P3
-      if(stateListRemove(&ptable.list[SLEEPING], p) == -1)
-        panic("no item in sleeping list");
-      assertState(p, SLEEPING, __FUNCTION__, __LINE__);
-      #endif
-      p->state = RUNNABLE;
-      #ifdef CS333_P3
-      stateListAdd(&ptable.list[RUNNABLE], p);
-      #endif
-    }
+  for(p=ptable.sleepq[SLEEPQ(chan)].head; p; p=next){
+    next = p->next;
+    if(p->chan == chan)
+      wakeproc(p);
   }
 }
 
@@ -991,6 +1516,54 @@ wakeup(void *chan)
   wakeup1(chan);
   release(&ptable.lock);
 }
+
+// Wake up only the process that has slept on chan the longest.
+// For resources one waiter can take at a time; a woken process that
+// leaves some behind must wake the next waiter itself.
+void
+wakeup_one(void *chan)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p=ptable.sleepq[SLEEPQ(chan)].head; p; p=p->next)
+    if(p->chan == chan){
+      wakeproc(p);
+      break;
+    }
+  release(&ptable.lock);
+}
+
+// Called by the timer interrupt after ticks advances.  Wakes the
+// timed sleepers whose deadline has passed; nobody else is touched.
+// The wheel is only peeked at without the lock, so a sleeper added
+// while we skip a tick is picked up when the wheel catches up.
+void
+timertick(void)
+{
+  struct proc *p, *next;
+  uint now, t;
+
+  if(ptable.ntimers == 0)
+    return;
+  acquire(&ptable.lock);
+  now = ticks;
+  t = ptable.wheeltime;
+  if(now - t > NTIMERSLOT)
+    t = now - NTIMERSLOT;
+  while(t != now){
+    t++;
+    for(p = ptable.wheel[t % NTIMERSLOT]; p; p = next){
+      next = p->tnext;
+      if((int)(now - p->wakeat) >= 0){
+        p->timedout = 1;
+        wakeproc(p);
+      }
+    }
+  }
+  ptable.wheeltime = now;
+  release(&ptable.lock);
+}
 #else
 static void
 wakeup1(void *chan)
@@ -1010,6 +1583,21 @@ wakeup(void *chan)
   wakeup1(chan);
   release(&ptable.lock);
 }
+
+// Wake up one process sleeping on chan.
+void
+wakeup_one(void *chan)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state == SLEEPING && p->chan == chan){
+      p->state = RUNNABLE;
+      break;
+    }
+  release(&ptable.lock);
+}
 #endif
 
 // Kill the process with the given pid.
@@ -1022,32 +1610,17 @@ kill(int pid)
   struct proc *p;
 
   acquire(&ptable.lock);
-  for(int i=1; i<=5; i++){
-    for(p=ptable.list[i].head; p; p=p->next){
-      if(p->pid == pid){
-        p->killed = 1;
-        // Wake process from sleep if necessary.
-        if(p->state == SLEEPING){
-          #ifdef CS333_P3
-          if(stateListRemove(&ptable.list[SLEEPING], p) == -1){
-            panic("no item in sleeping list");
-          }
-          assertState(p, SLEEPING, __FUNCTION__, __LINE__);
-          #endif
-          p->state = RUNNABLE;
-
-          #ifdef CS333_P3
-          stateListAdd(&ptable.list[RUNNABLE], p);
-          #endif
-
-        }
-        release(&ptable.lock);
-        return 0;
-      }
-    }
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  p->killed = 1;
+  // Wake process from sleep if necessary.
+  if(p->state == SLEEPING){
+    wakeproc(p);
   }
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 #else
 int
@@ -1079,7 +1652,19 @@ kill(int pid)
 void
 procdumpP4(struct proc *p, char *state_string)
 {
-  cprintf("TODO for Project 4, delete this line and implement procdumpP4() in proc.c to print a row\n");
+  uint elapsed = ticks - p->start_ticks;
+  uint cpu = p->cpu_ticks_total;
+
+  cprintf("%d\t%s\t\t%d\t%d\t", p->pid, p->name, p->uid, p->gid);
+  if(p->parent != NULL)
+    cprintf("%d\t", p->parent->pid);
+  else
+    cprintf("%d\t", p->pid);
+  cprintf("%d\t", p->priority);
+  cprintf("%d.%d%d%d\t", elapsed/1000, (elapsed%1000)/100,
+      (elapsed%100)/10, elapsed%10);
+  cprintf("%d.%d%d%d\t", cpu/1000, (cpu%1000)/100, (cpu%100)/10, cpu%10);
+  cprintf("%s\t%d\t", state_string, p->sz);
   return;
 }
 #elif defined(CS333_P3)
@@ -1222,18 +1807,22 @@ procdump(void)
 
 #if defined(CS333_P3)
 // list management helper functions
+// Lists are doubly linked through p->next and p->prev, so both
+// adding and removing a process is constant time.
+// A process is changed between taking it off one list and putting
+// it on the next, so those bracket the lockless readers' seqlock,
+// see seqBegin().
 static void
 stateListAdd(struct ptrs* list, struct proc* p)
 {
-  if((*list).head == NULL){
-    (*list).head = p;
-    (*list).tail = p;
-    p->next = NULL;
-  } else{
-    ((*list).tail)->next = p;
-    (*list).tail = ((*list).tail)->next;
-    ((*list).tail)->next = NULL;
-  }
+  p->next = NULL;
+  p->prev = list->tail;
+  if(list->head == NULL)
+    list->head = p;
+  else
+    list->tail->next = p;
+  list->tail = p;
+  seqEnd(p);
 }
 #endif
 
@@ -1241,48 +1830,32 @@ stateListAdd(struct ptrs* list, struct proc* p)
 static int
 stateListRemove(struct ptrs* list, struct proc* p)
 {
-  if((*list).head == NULL || (*list).tail == NULL || p == NULL){
+  if(list->head == NULL || list->tail == NULL || p == NULL){
     return -1;
   }
 
-  struct proc* current = (*list).head;
-  struct proc* previous = 0;
-
-  if(current == p){
-    (*list).head = ((*list).head)->next;
-    // prevent tail remaining assigned when we've removed the only item
-    // on the list
-    if((*list).tail == p){
-      (*list).tail = NULL;
-    }
-    return 0;
-  }
-
-  while(current){
-    if(current == p){
-      break;
-    }
-
-    previous = current;
-    current = current->next;
+  // Process not on this list. return error
+  if(p->prev == NULL ? list->head != p : p->prev->next != p){
+    return -1;
   }
-
-  // Process not found. return error
-  if(current == NULL){
+  if(p->next == NULL ? list->tail != p : p->next->prev != p){
     return -1;
   }
 
-  // Process found.
-  if(current == (*list).tail){
-    (*list).tail = previous;
-    ((*list).tail)->next = NULL;
-  } else{
-    previous->next = current->next;
-  }
+  if(p->prev)
+    p->prev->next = p->next;
+  else
+    list->head = p->next;
+  if(p->next)
+    p->next->prev = p->prev;
+  else
+    list->tail = p->prev;
 
-  // Make sure p->next doesn't point into the list.
+  // Make sure p doesn't point into the list.
   p->next = NULL;
+  p->prev = NULL;
 
+  seqBegin(p);
   return 0;
 }
 #endif
@@ -1297,11 +1870,28 @@ initProcessLists()
     ptable.list[i].head = NULL;
     ptable.list[i].tail = NULL;
   }
+  for (i = 0; i < NSLEEPQ; i++) {
+    ptable.sleepq[i].head = NULL;
+    ptable.sleepq[i].tail = NULL;
+  }
 #if defined(CS333_P4)
-  for (i = 0; i <= MAXPRIO; i++) {
-    ptable.ready[i].head = NULL;
-    ptable.ready[i].tail = NULL;
+  for (int c = 0; c < NCPU; c++) {
+    initlock(&ptable.rq[c].lock, "runq");
+#ifdef CS333_STRIDE
+    ptable.rq[c].vtime = 0;
+#else
+    for (i = 0; i <= MAXPRIO; i++) {
+      ptable.rq[c].ready[i].head = NULL;
+      ptable.rq[c].ready[i].tail = NULL;
+    }
+    ptable.rq[c].readymask = 0;
+#endif
+    ptable.rq[c].nready = 0;
+    ptable.nrunnable[c] = 0;
   }
+  ptable.rtready.head = ptable.rtready.tail = NULL;
+  ptable.rtthrottled.head = ptable.rtthrottled.tail = NULL;
+  ptable.PromoteAtTime = ticks + TICKS_TO_PROMOTE;
 #endif
 }
 #endif
@@ -1314,6 +1904,8 @@ initFreeList(void)
 
   for(p = ptable.proc; p < ptable.proc + NPROC; ++p){
     p->state = UNUSED;
+    p->tslot = -1;
+    seqBegin(p);
     stateListAdd(&ptable.list[UNUSED], p);
   }
 }
@@ -1335,10 +1927,839 @@ assertState(struct proc *p, enum procstate state, const char * func, int line)
 }
 #endif
 
+#if defined(CS333_STRIDE)
+// Min-heap on pass for the stride scheduler.  Passes wrap, so they
+// are compared by signed difference.
+#define PASSLESS(a, b) ((int)((a)->pass - (b)->pass) < 0)
+
+static void
+heapSwap(struct runq* rq, int i, int j)
+{
+  struct proc *p = rq->heap[i];
 
+  rq->heap[i] = rq->heap[j];
+  rq->heap[j] = p;
+  rq->heap[i]->heapidx = i;
+  rq->heap[j]->heapidx = j;
+}
 
+static void
+heapUp(struct runq* rq, int i)
+{
+  while(i > 0 && PASSLESS(rq->heap[i], rq->heap[(i - 1) / 2])){
+    heapSwap(rq, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
 
-#ifdef CS333_P2
+static void
+heapDown(struct runq* rq, int i)
+{
+  int l, min;
+
+  for(;;){
+    min = i;
+    l = 2 * i + 1;
+    if(l < rq->nready && PASSLESS(rq->heap[l], rq->heap[min]))
+      min = l;
+    if(l + 1 < rq->nready && PASSLESS(rq->heap[l + 1], rq->heap[min]))
+      min = l + 1;
+    if(min == i)
+      return;
+    heapSwap(rq, i, min);
+    i = min;
+  }
+}
+#endif
+
+#if defined(CS333_P3)
+// RUNNABLE processes are kept on the ready lists.  With CS333_P4 there
+// is one list per priority and ptable.readymask records which lists are
+// non-empty, so picking the next process is a find-first-set plus a
+// head pop no matter how many processes are queued.
+static void
+readyListAdd(struct proc* p)
+{
+#if defined(CS333_P4)
+  struct runq *rq;
+
+  // Queue p only where it is allowed to run.
+  if((p->affinity & (1 << p->cpu)) == 0)
+    p->cpu = highbit(p->affinity);
+  if(p->rtperiod){
+    rtReadyAdd(p);
+    return;
+  }
+  rq = &ptable.rq[p->cpu];
+  acquire(&rq->lock);
+#ifdef CS333_STRIDE
+  // A process that slept or moved CPUs gets no credit for the time
+  // it was away: start it no earlier than the queue's virtual time.
+  if((int)(p->pass - rq->vtime) < 0)
+    p->pass = rq->vtime;
+  p->heapidx = rq->nready;
+  rq->heap[rq->nready++] = p;
+  heapUp(rq, p->heapidx);
+  seqEnd(p);
+#else
+  stateListAdd(&rq->ready[p->priority], p);
+  rq->readymask |= 1 << p->priority;
+  rq->nready++;
+#endif
+  release(&rq->lock);
+  runnableFor(p, 1);
+  // Order the nrunnable stores before the idlemask load; an idle
+  // CPU sets its bit before it rechecks nrunnable.
+  __sync_synchronize();
+  if(ptable.idlemask)
+    kickIdle(p);
+#else
+  stateListAdd(&ptable.list[RUNNABLE], p);
+#endif
+}
+
+static int
+readyListRemove(struct proc* p)
+{
+#if defined(CS333_P4)
+  struct runq *rq = &ptable.rq[p->cpu];
+#ifdef CS333_STRIDE
+  int i = p->heapidx;
+  struct proc *last;
+#endif
+
+  if(p->rtperiod)
+    return rtReadyRemove(p);
+  acquire(&rq->lock);
+#ifdef CS333_STRIDE
+  if(i < 0 || i >= rq->nready || rq->heap[i] != p){
+    release(&rq->lock);
+    return -1;
+  }
+  seqBegin(p);
+  p->heapidx = -1;
+  last = rq->heap[--rq->nready];
+  if(i < rq->nready){
+    rq->heap[i] = last;
+    last->heapidx = i;
+    heapDown(rq, i);
+    heapUp(rq, last->heapidx);
+  }
+#else
+  if(stateListRemove(&rq->ready[p->priority], p) == -1){
+    release(&rq->lock);
+    return -1;
+  }
+  if(rq->ready[p->priority].head == NULL)
+    rq->readymask &= ~(1 << p->priority);
+  rq->nready--;
+#endif
+  release(&rq->lock);
+  runnableFor(p, -1);
+  return 0;
+#else
+  return stateListRemove(&ptable.list[RUNNABLE], p);
+#endif
+}
+
+// SLEEPING processes are queued in FIFO order on the wait queue
+// their channel hashes to, so wakeup() only looks at processes
+// that might be waiting on the same channel.
+static void
+sleepListAdd(struct proc* p)
+{
+  stateListAdd(&ptable.sleepq[SLEEPQ(p->chan)], p);
+}
+
+static int
+sleepListRemove(struct proc* p)
+{
+  return stateListRemove(&ptable.sleepq[SLEEPQ(p->chan)], p);
+}
+
+// Put sleeping p on the timer wheel to be woken at tick wakeat.
+// A deadline the wheel has already passed goes in the next slot
+// the wheel will look at.
+static void
+timerAdd(struct proc* p, uint wakeat)
+{
+  uint slot = wakeat;
+
+  if((int)(slot - (ptable.wheeltime + 1)) < 0)
+    slot = ptable.wheeltime + 1;
+  p->wakeat = wakeat;
+  p->tslot = slot % NTIMERSLOT;
+  p->tprev = 0;
+  p->tnext = ptable.wheel[p->tslot];
+  if(p->tnext)
+    p->tnext->tprev = p;
+  ptable.wheel[p->tslot] = p;
+  ptable.ntimers++;
+}
+
+static void
+timerRemove(struct proc* p)
+{
+  if(p->tprev)
+    p->tprev->tnext = p->tnext;
+  else
+    ptable.wheel[p->tslot] = p->tnext;
+  if(p->tnext)
+    p->tnext->tprev = p->tprev;
+  p->tnext = p->tprev = 0;
+  p->tslot = -1;
+  ptable.ntimers--;
+}
+
+// Make sleeping p RUNNABLE, taking it off its wait queue and,
+// if it has a timeout, off the timer wheel.
+// The ptable lock must be held.
+static void
+wakeproc(struct proc* p)
+{
+  if(sleepListRemove(p) == -1)
+    panic("no item in sleeping list");
+  assertState(p, SLEEPING, __FUNCTION__, __LINE__);
+  if(p->tslot >= 0)
+    timerRemove(p);
+#ifdef CS333_P4
+  p->woken = 1;
+  p->readyat = ticks;
+#endif
+  p->state = RUNNABLE;
+  readyListAdd(p);
+}
+
+// Each process keeps its live children on p->children and its
+// exited, not yet reaped children on p->zombies, linked through
+// sibnext and sibprev.  The ptable lock must be held.
+static void
+childAdd(struct proc** head, struct proc* p)
+{
+  p->sibprev = 0;
+  p->sibnext = *head;
+  if(*head)
+    (*head)->sibprev = p;
+  *head = p;
+}
+
+static void
+childRemove(struct proc** head, struct proc* p)
+{
+  if(p->sibprev)
+    p->sibprev->sibnext = p->sibnext;
+  else
+    *head = p->sibnext;
+  if(p->sibnext)
+    p->sibnext->sibprev = p->sibprev;
+  p->sibnext = p->sibprev = 0;
+}
+
+// Writers bracket every change to the fields getprocs() reports
+// with seqBegin() and seqEnd(), so p->seq is odd while p is
+// inconsistent and lockless readers retry, see procSnapshot().
+// Under ptable.lock the state list helpers do this.
+static void
+seqBegin(struct proc* p)
+{
+  p->seq++;
+  __sync_synchronize();
+}
+
+// p->gen, the generation getprocsince() compares, is the tick of
+// the change.  Reading ticks keeps context switches from contending
+// for a shared counter; readers must then take changes in the tick
+// they last asked at as possibly new.
+static void
+seqEnd(struct proc* p)
+{
+  __sync_synchronize();
+  p->gen = ticks;
+  p->seq++;
+}
+
+// For a process changing its own fields without ptable.lock.
+// Interrupts stay off in between so it can't be preempted, which
+// would move it between state lists in mid-write.
+void
+procwritebegin(struct proc* p)
+{
+  pushcli();
+  seqBegin(p);
+}
+
+void
+procwriteend(struct proc* p)
+{
+  seqEnd(p);
+  popcli();
+}
+
+// Remember that pid was reaped at generation (tick) gen, for
+// getprocsince().  The ptable lock must be held.
+static void
+exitedAdd(uint pid, uint gen)
+{
+  ptable.exitseq++;
+  __sync_synchronize();
+  ptable.exited[ptable.nexited % NEXITED].pid = pid;
+  ptable.exited[ptable.nexited % NEXITED].gen = gen;
+  ptable.nexited++;
+  __sync_synchronize();
+  ptable.exitseq++;
+}
+
+// Allocated processes are chained on ptable.pidhash from allocproc()
+// until wait() reaps them.  The ptable lock must be held.
+static void
+pidHashAdd(struct proc* p)
+{
+  struct proc **pp = &ptable.pidhash[PIDHASH(p->pid)];
+
+  p->pidnext = *pp;
+  *pp = p;
+}
+
+static void
+pidHashRemove(struct proc* p)
+{
+  struct proc **pp;
+
+  for(pp = &ptable.pidhash[PIDHASH(p->pid)]; *pp; pp = &(*pp)->pidnext)
+    if(*pp == p){
+      *pp = p->pidnext;
+      p->pidnext = 0;
+      return;
+    }
+  panic("pidHashRemove");
+}
+
+// Return the allocated process with the given pid or 0.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = ptable.pidhash[PIDHASH(pid)]; p; p = p->pidnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+#endif
+
+#if defined(CS333_P4)
+// Count the time p spent RUNNABLE since p->readyat in its own
+// histogram and in the one for the priority it is dispatched at.
+// The ptable lock must be held.
+static void
+latRecord(struct proc* p)
+{
+  uint wait = ticks - p->readyat;
+  int b = wait == 0 ? 0 : highbit(wait) + 1;
+
+  if(b >= NLATBUCKET)
+    b = NLATBUCKET - 1;
+  if(p->woken){
+    ptable.lat[p - ptable.proc].wakeup[b]++;
+    ptable.priolat[p->priority].wakeup[b]++;
+  } else {
+    ptable.lat[p - ptable.proc].runq[b]++;
+    ptable.priolat[p->priority].runq[b]++;
+  }
+}
+
+// Real-time processes are scheduled earliest deadline first, ahead
+// of every other process, from one queue shared by all CPUs.  Each
+// period of rtperiod ticks a process may run for rtbudget ticks;
+// schedtick() charges it and moves it to rtthrottled once it is out of
+// budget until its deadline, when the next period starts.
+
+// Start a new period if the current one is over.
+static void
+rtRefill(struct proc* p)
+{
+  if((int)(ticks - p->rtdeadline) >= 0){
+    p->rtdeadline = ticks + p->rtperiod;
+    p->rtleft = p->rtbudget;
+  }
+}
+
+static void
+rtReadyAdd(struct proc* p)
+{
+  struct proc *q;
+
+  rtRefill(p);
+  if(p->rtleft == 0){
+    stateListAdd(&ptable.rtthrottled, p);
+    return;
+  }
+  // Deadlines mostly grow, so search for p's place from the tail.
+  for(q = ptable.rtready.tail; q; q = q->prev)
+    if((int)(q->rtdeadline - p->rtdeadline) <= 0)
+      break;
+  p->prev = q;
+  if(q){
+    p->next = q->next;
+    q->next = p;
+  } else {
+    p->next = ptable.rtready.head;
+    ptable.rtready.head = p;
+  }
+  if(p->next)
+    p->next->prev = p;
+  else
+    ptable.rtready.tail = p;
+  seqEnd(p);
+  ptable.nrt++;
+  runnableFor(p, 1);
+  __sync_synchronize();
+  if(ptable.idlemask)
+    kickIdle(p);
+}
+
+static int
+rtReadyRemove(struct proc* p)
+{
+  if(p->rtleft == 0)
+    return stateListRemove(&ptable.rtthrottled, p);
+  if(stateListRemove(&ptable.rtready, p) == -1)
+    return -1;
+  ptable.nrt--;
+  runnableFor(p, -1);
+  return 0;
+}
+
+// Earliest deadline RT process that may run on cpu, or 0.
+static struct proc*
+rtPick(int cpu)
+{
+  struct proc *p;
+
+  for(p = ptable.rtready.head; p; p = p->next)
+    if(p->affinity & (1 << cpu))
+      return p;
+  return 0;
+}
+
+// Called on every CPU's timer interrupt.  Charge the tick to the
+// running process's time slice and to its RT or MLFQ budget, and ask
+// trap() to preempt it once either runs out.  It is also preempted
+// when RT work this CPU may run is waiting and would run first: any
+// RT process before an ordinary one, an earlier deadline before a
+// later one.  CPU 0 also starts the next period of throttled
+// processes.
+void
+schedtick(void)
+{
+  struct cpu *c = mycpu();
+  struct proc *p = c->proc, *next, *q;
+
+  if(p){
+    if(--p->slice <= 0)
+      c->resched = 1;
+    if(p->rtperiod){
+      if(p->rtleft > 0 && --p->rtleft == 0)
+        c->resched = 1;
+    } else {
+#ifndef CS333_STRIDE
+      if(--p->budget <= 0)
+        c->resched = 1;
+#endif
+    }
+    if(!c->resched && ptable.nrt > 0){
+      acquire(&ptable.lock);
+      if((q = rtPick(cpuid())) != 0 &&
+         (p->rtperiod == 0 || (int)(q->rtdeadline - p->rtdeadline) < 0))
+        c->resched = 1;
+      release(&ptable.lock);
+    }
+  }
+
+  if(c != &cpus[0] || ptable.rtthrottled.head == 0)
+    return;
+  acquire(&ptable.lock);
+  for(p = ptable.rtthrottled.head; p; p = next){
+    next = p->next;
+    if((int)(ticks - p->rtdeadline) >= 0){
+      stateListRemove(&ptable.rtthrottled, p);
+      rtReadyAdd(p);
+    }
+  }
+  release(&ptable.lock);
+}
+
+// Put pid in the real-time class with the given period and budget
+// in ticks, or take it out if period is 0.  Fails if the period is
+// longer than MAXRTPERIOD or the RT classes' total utilization would
+// exceed the number of CPUs.
+int
+setrt(int pid, int period, int budget)
+{
+  struct proc *p;
+  uint util = 0;
+  int runnable;
+
+  if(period < 0 || period > MAXRTPERIOD ||
+     (period > 0 && (budget <= 0 || budget > period)))
+    return -1;
+  if(period > 0)
+    util = budget * 1000 / period;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  if(ptable.rtutil - p->rtutil + util > ncpu * 1000){
+    release(&ptable.lock);
+    return -1;
+  }
+  ptable.rtutil += util - p->rtutil;
+  p->rtutil = util;
+  runnable = p->state == RUNNABLE;
+  if(runnable && readyListRemove(p) == -1)
+    panic("no item in ready list");
+  p->rtperiod = period;
+  p->rtbudget = budget;
+  p->rtdeadline = ticks + period;
+  p->rtleft = budget;
+  if(runnable)
+    readyListAdd(p);
+  release(&ptable.lock);
+  return 0;
+}
+
+#ifdef CS333_STRIDE
+// Lowest pass process on cpu's run queue.  Everything there may run
+// on cpu, see readyListAdd().  If that queue is empty, steal the
+// lowest pass process allowed on cpu from the busiest queue that has
+// one.  Returns 0 if there is nothing cpu may run.
+static struct proc*
+readyListPick(int cpu)
+{
+  struct runq *rq = &ptable.rq[cpu];
+  struct proc *p, *best = 0, *min;
+  int i, j, bestready = 0;
+
+  if((p = rtPick(cpu)) != 0)
+    return p;
+  acquire(&rq->lock);
+  p = rq->nready ? rq->heap[0] : 0;
+  release(&rq->lock);
+  if(p)
+    return p;
+  for(i = 0; i < ncpu; i++){
+    rq = &ptable.rq[i];
+    if(rq->nready <= bestready)
+      continue;
+    acquire(&rq->lock);
+    min = 0;
+    for(j = 0; j < rq->nready; j++){
+      p = rq->heap[j];
+      if((p->affinity & (1 << cpu)) && (min == 0 || PASSLESS(p, min)))
+        min = p;
+    }
+    if(min){
+      best = min;
+      bestready = rq->nready;
+    }
+    release(&rq->lock);
+  }
+  return best;
+}
+#else
+// Head of the highest priority non-empty ready list of cpu's run
+// queue.  Everything there may run on cpu, see readyListAdd().  If
+// that queue is empty, steal the highest priority process whose
+// affinity allows cpu, from the busiest queue on a tie.  Returns 0
+// if there is nothing cpu may run.
+static struct proc*
+readyListPick(int cpu)
+{
+  struct runq *rq = &ptable.rq[cpu];
+  struct proc *p, *best = 0;
+  int i, prio, bestprio = -1, bestready = 0;
+
+  if((p = rtPick(cpu)) != 0)
+    return p;
+  acquire(&rq->lock);
+  p = rq->readymask ? rq->ready[highbit(rq->readymask)].head : 0;
+  release(&rq->lock);
+  if(p)
+    return p;
+  for(i = 0; i < ncpu; i++){
+    rq = &ptable.rq[i];
+    if(rq->nready == 0)
+      continue;
+    acquire(&rq->lock);
+    for(prio = MAXPRIO; prio >= bestprio && prio >= 0; prio--){
+      for(p = rq->ready[prio].head; p; p = p->next)
+        if(p->affinity & (1 << cpu))
+          break;
+      if(p == 0)
+        continue;
+      if(prio > bestprio || rq->nready > bestready){
+        best = p;
+        bestprio = prio;
+        bestready = rq->nready;
+      }
+      break;
+    }
+    release(&rq->lock);
+  }
+  return best;
+}
+#endif
+
+// Is a process that cpu may run waiting on any run queue?  Read
+// without ptable.lock, so the answer is only a hint; it is exact
+// when readyListPick(cpu) would find nothing.
+static int
+runnableWaiting(int cpu)
+{
+  return ptable.nrunnable[cpu] > 0;
+}
+
+// Count queued process p in, or with n = -1 out of, nrunnable[]
+// for every CPU its affinity allows.  The ptable lock must be held.
+static void
+runnableFor(struct proc* p, int n)
+{
+  int i;
+
+  for(i = 0; i < ncpu; i++)
+    if(p->affinity & (1 << i))
+      ptable.nrunnable[i] += n;
+}
+
+// Wake a halted CPU that may run p, preferring p->cpu, the one whose
+// queue got it.  The ptable lock must be held.
+static void
+kickIdle(struct proc* p)
+{
+  uint mask = ptable.idlemask & p->affinity & ~(1 << cpuid());
+  int cpu = p->cpu;
+
+  if(mask == 0)
+    return;
+  if((mask & (1 << cpu)) == 0)
+    cpu = highbit(mask);
+  atom_clearbit(&ptable.idlemask, cpu);
+  lapicipi(cpus[cpu].apicid, T_WAKEUP);
+}
+
+// Load averages are updated every LOADFREQ ticks by decaying
+// toward the number of RUNNING and RUNNABLE processes; the
+// constants are FIXED_1/exp(5s/1min), /exp(5s/5min), /exp(5s/15min).
+#define LOADFREQ (5 * TPS)
+static uint loadexp[3] = { 1884, 2014, 2037 };
+
+// Charge this timer tick to the CPU's busy or idle count, and the
+// time trap() measured in interrupt handlers since the last tick to
+// its interrupt time, in thousandths of a tick as long as this one.
+// Called on every CPU's timer interrupt; CPU 0 also keeps the load
+// average.
+void
+cpustattick(void)
+{
+  struct cpu *c = mycpu();
+  uint n, now, unit;
+  int i;
+
+  if(c->proc)
+    c->busyticks++;
+  else
+    c->idleticks++;
+  now = rdtsc();
+  unit = (now - c->ticktsc) / 1000;
+  if(unit)
+    c->intrtime += min(c->intrcycles / unit, 1000);
+  c->intrcycles = 0;
+  c->ticktsc = now;
+  if(c != &cpus[0] || ticks % LOADFREQ != 0)
+    return;
+
+  // Lockless snapshot; a stale count only skews one sample.
+  n = 0;
+  for(i = 0; i < ncpu; i++){
+    n += ptable.rq[i].nready;
+    if(cpus[i].proc)
+      n++;
+  }
+  for(i = 0; i < 3; i++)
+    ptable.loadavg[i] = (ptable.loadavg[i] * loadexp[i] +
+        n * FIXED_1 * (FIXED_1 - loadexp[i])) >> FSHIFT;
+}
+
+// Demote p one level once schedtick() has used up its budget.  The
+// stride scheduler instead advances p's pass by its stride per tick
+// used, charging at least one tick so a process can't run for free.
+static void
+updateBudget(struct proc* p)
+{
+  if(p->rtperiod)
+    return;
+#ifdef CS333_STRIDE
+  uint used = ticks - p->cpu_ticks_in;
+
+  p->pass += p->stride * (used ? used : 1);
+#else
+  if(p->budget <= 0){
+    if(p->priority > 0)
+      p->priority--;
+    p->budget = BUDGET;
+  }
+#endif
+}
+
+#ifndef CS333_STRIDE
+static void
+promote(struct proc* p)
+{
+  if(p->priority < MAXPRIO){
+    p->priority++;
+    p->budget = BUDGET;
+  }
+}
+
+// Move every process up one priority level.  Ready lists are
+// walked from the top down so no process is promoted twice.
+static void
+promoteAll(void)
+{
+  struct proc *p;
+
+  for(int i = 0; i < NSLEEPQ; i++)
+    for(p=ptable.sleepq[i].head; p; p=p->next){
+      seqBegin(p);
+      promote(p);
+      seqEnd(p);
+    }
+  for(p=ptable.list[RUNNING].head; p; p=p->next){
+    seqBegin(p);
+    promote(p);
+    seqEnd(p);
+  }
+  for(int c = 0; c < ncpu; c++){
+    for(int i = MAXPRIO-1; i >= 0; i--){
+      while((p = ptable.rq[c].ready[i].head) != NULL){
+        readyListRemove(p);
+        promote(p);
+        readyListAdd(p);
+      }
+    }
+  }
+}
+#endif
+#endif
+
+
+
+
+#if defined(CS333_P3)
+// Copy p into u without ptable.lock, retrying if a writer changed p
+// meanwhile.  Returns p's state and sets *gen to p's generation.
+static enum procstate
+procSnapshot(struct proc* p, struct uproc* u, uint* gen)
+{
+  enum procstate state;
+  struct proc *parent;
+  uint seq;
+
+  do {
+    while((seq = p->seq) & 1)
+      ;
+    __sync_synchronize();
+    state = p->state;
+    *gen = p->gen;
+    u->pid = p->pid;
+    safestrcpy(u->name, p->name, sizeof(p->name));
+    u->uid = p->uid;
+    u->gid = p->gid;
+    parent = p->parent;
+    u->ppid = parent ? parent->pid : p->pid;
+    u->CPU_total_ticks = p->cpu_ticks_total;
+    u->elapsed_ticks = p->cpu_ticks_in;
+    safestrcpy(u->state, states[state], STRMAX);
+    u->size = p->sz;
+    #ifdef CS333_P4
+    u->priority = p->priority;
+    #endif
+    __sync_synchronize();
+  } while(p->seq != seq);
+  return state;
+}
+
+// Fill table with up to max processes changed at or after
+// generation since, 0 for all of them.  Reads the process table
+// without ptable.lock.
+static int
+procsSince(uint max, struct uproc *table, uint since)
+{
+  struct proc *p;
+  enum procstate state;
+  uint gen;
+  int i = 0;
+
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && i < max; p++){
+    state = procSnapshot(p, &table[i], &gen);
+    if(state != UNUSED && state != EMBRYO && gen >= since)
+      i++;
+  }
+  return i;
+}
+
+int
+getprocs(uint max, struct uproc *table)
+{
+  if(max > NPROC && max != 72)
+    return -1;
+  return procsSince(max, table, 0);
+}
+
+// Like getprocs() but only for processes changed since generation
+// *gen, plus an "unused" entry for each pid reaped since then.  *gen
+// is set to the current generation for the next call.  A generation
+// is a tick, so changes in tick *gen itself are reported again.
+// Returns -1 if reaped pids were forgotten since *gen; start again
+// from 0.
+int
+getprocsince(uint max, struct uproc *table, uint *gen)
+{
+  uint since = *gen, now = ticks;
+  uint seq, n, k;
+  int i, nlive;
+
+  if(max > NPROC)
+    return -1;
+  __sync_synchronize();  // read ticks before any process
+  nlive = procsSince(max, table, since);
+  if(since == 0){
+    *gen = now;
+    return nlive;
+  }
+  do {
+    i = nlive;
+    while((seq = ptable.exitseq) & 1)
+      ;
+    __sync_synchronize();
+    n = ptable.nexited;
+    if(n > NEXITED && ptable.exited[n % NEXITED].gen >= since)
+      return -1;
+    for(k = n > NEXITED ? n - NEXITED : 0; k < n && i < max; k++){
+      if(ptable.exited[k % NEXITED].gen < since)
+        continue;
+      memset(&table[i], 0, sizeof(table[i]));
+      table[i].pid = ptable.exited[k % NEXITED].pid;
+      safestrcpy(table[i].state, states[UNUSED], STRMAX);
+      i++;
+    }
+    __sync_synchronize();
+  } while(ptable.exitseq != seq);
+  *gen = now;
+  return i;
+}
+#elif defined(CS333_P2)
 int
 getprocs(uint max, struct uproc *table)
 {
@@ -1377,6 +2798,9 @@ getprocs(uint max, struct uproc *table)
 			table[i].elapsed_ticks = p->cpu_ticks_in;
 			strncpy(table[i].state,states[p->state], sizeof(p->name));
 			table[i].size = p->sz;
+			#ifdef CS333_P4
+			table[i].priority = p->priority;
+			#endif
 			i++;
 		} 
   }
@@ -1417,6 +2841,51 @@ getprocs(uint max, struct uproc *table)
 //dumps for control-r s z f
 
 #ifdef CS333_P3
+#ifdef CS333_STRIDE
+void
+readydump(void)
+{
+  struct proc *p;
+
+  cprintf("Ready List Processes:\n");
+  for(int c = 0; c < ncpu; c++){
+    acquire(&ptable.rq[c].lock);
+    cprintf("cpu%d: ", c);
+    for(int i = 0; i < ptable.rq[c].nready; i++){
+      p = ptable.rq[c].heap[i];
+      assertState(p, RUNNABLE, __FUNCTION__, __LINE__);
+      cprintf("(%d, %d)", p->pid, p->pass);
+      if(i + 1 < ptable.rq[c].nready)
+        cprintf(" -> ");
+    }
+    cprintf("\n");
+    release(&ptable.rq[c].lock);
+  }
+}
+#elif defined(CS333_P4)
+void
+readydump(void)
+{
+  struct proc *p;
+
+  cprintf("Ready List Processes:\n");
+  for(int c = 0; c < ncpu; c++){
+    acquire(&ptable.rq[c].lock);
+    cprintf("cpu%d:\n", c);
+    for(int i = MAXPRIO; i >= 0; i--){
+      cprintf("%d: ", i);
+      for(p=ptable.rq[c].ready[i].head; p; p=p->next){
+        assertState(p, RUNNABLE, __FUNCTION__, __LINE__);
+        cprintf("(%d, %d)", p->pid, p->budget);
+        if(p->next)
+          cprintf(" -> ");
+      }
+      cprintf("\n");
+    }
+    release(&ptable.rq[c].lock);
+  }
+}
+#else
 void
 readydump(void)
 {
@@ -1445,6 +2914,7 @@ readydump(void)
   release(&ptable.lock);
   return;
 }
+#endif
 
 void
 freedump(void)
@@ -1464,21 +2934,25 @@ void
 sleepdump(void)
 {
   struct proc *p;
+  int empty = 1;
   acquire(&ptable.lock);
   cprintf("Sleep List Processes:\n");
-  if(ptable.list[SLEEPING].head == NULL){
-    cprintf("Sleep List is Empty\n");
-    release(&ptable.lock);
-    return;
-  }
-  for(p=ptable.list[SLEEPING].head; p; p=p->next){
-    assertState(p,SLEEPING,__FUNCTION__, __LINE__);
-    cprintf("%d",p->pid);
-    if(p->next)
-      cprintf("->");
+  for(int i = 0; i < NSLEEPQ; i++){
+    if(ptable.sleepq[i].head == NULL)
+      continue;
+    empty = 0;
+    cprintf("%d: ", i);
+    for(p=ptable.sleepq[i].head; p; p=p->next){
+      assertState(p,SLEEPING,__FUNCTION__, __LINE__);
+      cprintf("%d",p->pid);
+      if(p->next)
+        cprintf("->");
+    }
+    cprintf("\n");
   }
+  if(empty)
+    cprintf("Sleep List is Empty\n");
   release(&ptable.lock);
-  cprintf("\n");
 }
 
 void
@@ -1507,14 +2981,179 @@ zombiedump(void)
 
 
 #ifdef CS333_P4
-int setpriority(int pid, int priority)
+// Set the priority of process pid and reset its budget.  A RUNNABLE
+// process is moved to the ready list for its new priority.
+int
+setpriority(int pid, int priority)
 {
-  return -1;
+  struct proc *p;
+
+  if(priority < 0 || priority > MAXPRIO)
+    return -1;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  if(p->state == RUNNABLE){
+    if(readyListRemove(p) == -1)
+      panic("no item in ready list");
+    p->priority = priority;
+    readyListAdd(p);
+  } else {
+    seqBegin(p);
+    p->priority = priority;
+    seqEnd(p);
+  }
+  p->budget = BUDGET;
+  release(&ptable.lock);
+  return 0;
 }
 
-int getpriority(int pid)
+int
+getpriority(int pid)
 {
-  return -1;
+  struct proc *p;
+  int priority;
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  priority = p->priority;
+  release(&ptable.lock);
+  return priority;
 }
 
-#endif
\ No newline at end of file
+// Restrict pid to the CPUs in mask.  A RUNNABLE process is
+// requeued at once; a RUNNING one moves when it next yields, which
+// the caller does at once if it just excluded its own CPU.
+int
+setaffinity(int pid, uint mask)
+{
+  struct proc *p;
+  int moveme;
+
+  mask &= (1 << ncpu) - 1;
+  if(mask == 0)
+    return -1;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  if(p->state == RUNNABLE){
+    if(readyListRemove(p) == -1)
+      panic("no item in ready list");
+    p->affinity = mask;
+    readyListAdd(p);
+  } else
+    p->affinity = mask;
+  moveme = p == myproc() && (mask & (1 << cpuid())) == 0;
+  release(&ptable.lock);
+  if(moveme)
+    yield();
+  return 0;
+}
+
+int
+getaffinity(int pid)
+{
+  struct proc *p;
+  int mask;
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  mask = p->affinity & ((1 << ncpu) - 1);
+  release(&ptable.lock);
+  return mask;
+}
+
+#ifdef CS333_STRIDE
+// Give pid a share of the CPU proportional to tickets.  The new
+// stride applies from the next time pid is charged.
+int
+settickets(int pid, int tickets)
+{
+  struct proc *p;
+
+  if(tickets < 1 || tickets > MAXTICKETS)
+    return -1;
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  p->tickets = tickets;
+  p->stride = STRIDE1 / tickets;
+  release(&ptable.lock);
+  return 0;
+}
+
+int
+gettickets(int pid)
+{
+  struct proc *p;
+  int tickets;
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  tickets = p->tickets;
+  release(&ptable.lock);
+  return tickets;
+}
+#endif
+
+int
+getcpustats(struct cpustats *st)
+{
+  struct cpu *c;
+  int i;
+
+  acquire(&ptable.lock);
+  st->ncpu = ncpu;
+  for(i = 0; i < 3; i++)
+    st->load[i] = ptable.loadavg[i];
+  for(i = 0; i < ncpu; i++){
+    c = &cpus[i];
+    st->cpu[i].busy = c->busyticks;
+    st->cpu[i].idle = c->idleticks;
+    st->cpu[i].intr = c->intrtime;
+    st->cpu[i].nintr = c->nintr;
+    st->cpu[i].nswtch = c->nswtch;
+    st->cpu[i].nready = ptable.rq[i].nready;
+  }
+  release(&ptable.lock);
+  return 0;
+}
+
+// Copy out scheduler latency histograms.  pid 0 selects the
+// MAXPRIO+1 per-priority histograms, otherwise sl gets the
+// histogram of process pid.
+int
+getschedlat(int pid, struct schedlat *sl)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  if(pid == 0){
+    memmove(sl, ptable.priolat, sizeof(ptable.priolat));
+    release(&ptable.lock);
+    return 0;
+  }
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  *sl = ptable.lat[p - ptable.proc];
+  release(&ptable.lock);
+  return 0;
+}
+#endif
@@ -8,6 +8,16 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  #ifdef CS333_P4
+  uint busyticks;              // timer ticks with a process running
+  uint idleticks;              // timer ticks in the scheduler
+  uint nintr;                  // interrupts taken
+  uint intrtime;               // thousandths of a tick in interrupt handlers
+  uint intrcycles;             // TSC cycles in handlers since the last tick
+  uint ticktsc;                // TSC at the last timer interrupt
+  uint nswtch;                 // processes dispatched
+  int resched;                 // yield at the end of this trap
+  #endif
 };
 
 extern struct cpu cpus[NCPU];
@@ -34,6 +44,16 @@ struct context {
 
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// A loadable segment of the program or runtime library file,
+// read in a page at a time by lazyfault() as it is touched.
+struct seg {
+  struct inode *ip;            // File, or 0 if unused
+  uint va;                     // Start address, page aligned
+  uint memsz;                  // Size in memory
+  uint off;                    // File offset of va
+  uint filesz;                 // Bytes from the file; the rest is zero
+};
+
 // Per-process state
 struct proc {
   uint sz;                     // Size of process memory (bytes)
@@ -49,6 +69,7 @@ struct proc {
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  struct seg seg[NSEG];        // Program and library segments
 
   #ifdef CS333_P1
   uint start_ticks;            // CS333 P1
@@ -64,11 +85,40 @@ struct proc {
 
   #ifdef CS333_P3
   struct proc* next;
+  struct proc* prev;
+  uint wakeat;                 // tick to wake a timed sleeper at
+  int tslot;                   // timer wheel slot, or -1 if none
+  struct proc *tnext, *tprev;  // timer wheel slot list
+  int timedout;                // woken by the timer wheel
+  struct proc *children;       // live children
+  struct proc *zombies;        // exited children waiting to be reaped
+  struct proc *sibnext, *sibprev; // parent's children or zombies list
+  struct proc *pidnext;        // ptable.pidhash bucket
+  int isthread;                // made by clone(), reaped by join()
+  void *ustack;                // user stack given to clone()
+  volatile uint seq;           // odd while being changed, see procwritebegin()
+  uint gen;                    // ticks at the last change
   #endif
 
   #ifdef CS333_P4
 	uint priority;
 	int budget;
+  int slice;                   // ticks left in the current time slice
+  int cpu;                     // CPU whose run queue holds this proc
+  uint readyat;                // ticks when last made RUNNABLE
+  int woken;                   // made RUNNABLE by a wakeup
+  uint affinity;               // bit c set if the proc may run on CPU c
+  uint rtperiod;               // real-time period in ticks, 0 if not RT
+  uint rtbudget;               // ticks it may run each period
+  uint rtdeadline;             // end of the current period
+  uint rtleft;                 // budget left in the current period
+  uint rtutil;                 // share admitted by setrt(), per mille
+  #ifdef CS333_STRIDE
+  uint tickets;                // share of the CPU
+  uint stride;                 // STRIDE1 / tickets
+  uint pass;                   // virtual time; lowest pass runs next
+  int heapidx;                 // index in the run queue heap, or -1
+  #endif
 	#endif
 };
 
@@ -7,7 +7,11 @@
 
 int main(int argc, char *argv[])
 {
+	#ifdef CS333_P4
+	#define HEADER "PID\tName\t\tUID\tGID\tPPID\tPrio\tElapsed\tCPU\tState\tSize\t\n"
+	#else
 	#define HEADER "PID\tName\t\tUID\tGID\tPPID\tElapsed\tCPU\tState\tSize\t\n"
+	#endif
 	
 	if(argc < 2)
 	{
@@ -37,6 +41,9 @@ int main(int argc, char *argv[])
 		printf(1, "%d\t", tmp->uid);
 		printf(1, "%d\t", tmp->gid);
 		printf(1, "%d\t", tmp->ppid);
+		#ifdef CS333_P4
+		printf(1, "%d\t", tmp->priority);
+		#endif
 	
 	    up = uptime();
 		T11 = up % 10;
@@ -0,0 +1,63 @@
+#ifdef CS333_P4
+
+#include "types.h"
+#include "user.h"
+#include "pdx.h"
+#include "schedlat.h"
+
+// Print scheduler latency histograms: per priority level with no
+// arguments, otherwise for each pid given.  Rows are buckets of
+// ticks spent RUNNABLE before being dispatched.
+
+static void
+print(char *label, int id, struct schedlat *sl)
+{
+  int i;
+
+  printf(1, "%s %d\n", label, id);
+  printf(1, "Ticks\t\tRunq\tWakeup\n");
+  for(i = 0; i < NLATBUCKET; i++){
+    if(sl->runq[i] == 0 && sl->wakeup[i] == 0)
+      continue;
+    if(i == 0)
+      printf(1, "0\t\t");
+    else if(i == NLATBUCKET - 1)
+      printf(1, "%d+\t\t", 1 << (i - 1));
+    else if(i == 1)
+      printf(1, "1\t\t");
+    else
+      printf(1, "%d-%d\t\t", 1 << (i - 1), (1 << i) - 1);
+    printf(1, "%d\t%d\n", sl->runq[i], sl->wakeup[i]);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedlat prio[MAXPRIO + 1];
+  struct schedlat sl;
+  int i, pid;
+
+  if(argc < 2){
+    if(getschedlat(0, prio) < 0){
+      printf(2, "schedlat: getschedlat failed\n");
+      exit();
+    }
+    for(i = MAXPRIO; i >= 0; i--){
+      print("Priority", i, &prio[i]);
+    }
+    exit();
+  }
+
+  for(i = 1; i < argc; i++){
+    pid = atoi(argv[i]);
+    if(getschedlat(pid, &sl) < 0){
+      printf(2, "schedlat: no process %d\n", pid);
+      continue;
+    }
+    print("PID", pid, &sl);
+  }
+  exit();
+}
+
+#endif
@@ -0,0 +1,9 @@
+// Scheduler latency histograms, see getschedlat().
+// Bucket 0 counts waits of 0 ticks and bucket i > 0 waits of
+// [2^(i-1), 2^i) ticks.  The last bucket is open ended.
+#define NLATBUCKET 16
+
+struct schedlat {
+  uint runq[NLATBUCKET];       // new, yielded or preempted until run
+  uint wakeup[NLATBUCKET];     // woken from sleep until run
+};
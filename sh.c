@@ -51,6 +51,9 @@ struct backcmd {
 };
 
 int fork1(void);  // Fork but panics on failure.
+#ifdef CS333_P3
+int spawnline(char*);
+#endif
 void panic(char*);
 struct cmd *parsecmd(char*);
 
@@ -250,6 +253,10 @@ main(void)
       dobuiltin(buf);
       continue;
     }
+#endif
+#ifdef CS333_P3
+    if(spawnline(buf) == 0)
+      continue;
 #endif
     if(fork1() == 0)
       runcmd(parsecmd(buf));
@@ -578,3 +585,47 @@ nulterminate(struct cmd *cmd)
   }
   return cmd;
 }
+
+#ifdef CS333_P3
+// Run a command line made only of words with spawn(), so the
+// shell is not copied just to exec.  Return -1, leaving buf
+// untouched, if the line needs the parser and runcmd();
+// otherwise buf is changed in place.
+int
+spawnline(char *buf)
+{
+  char *argv[MAXARGS], *s;
+  int argc;
+
+  // Check the whole line before writing to it.
+  argc = 0;
+  for(s = buf; *s; s++){
+    if(strchr(symbols, *s))
+      return -1;
+    if(!strchr(whitespace, *s) && (s == buf || strchr(whitespace, s[-1])))
+      argc++;
+  }
+  if(argc >= MAXARGS)
+    return -1;
+  argc = 0;
+  s = buf;
+  for(;;){
+    while(*s && strchr(whitespace, *s))
+      *s++ = 0;
+    if(*s == 0)
+      break;
+    argv[argc++] = s;
+    while(*s && !strchr(whitespace, *s))
+      s++;
+  }
+  argv[argc] = 0;
+  if(argc == 0)
+    return 0;
+  if(spawn(argv[0], argv, 0) < 0){
+    printf(2, "exec %s failed\n", argv[0]);
+    return 0;
+  }
+  wait();
+  return 0;
+}
+#endif
@@ -0,0 +1,79 @@
+#ifdef CS333_STRIDE
+
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+#include "uproc.h"
+
+// This tests proportional sharing under the stride scheduler.
+//
+// NCHILD spinning children are pinned to CPU 0 with tickets in the
+// ratio 1:2:3.  After RUNSECS seconds each child's share of their
+// total CPU time must be within TOLERANCE percent of its share of the
+// tickets.
+
+#define NCHILD 3
+#define RUNSECS 10
+#define TOLERANCE 5
+
+int
+main(void)
+{
+  int pid[NCHILD];
+  struct uproc *table;
+  int i, j, n, got, want, success;
+  uint cpu[NCHILD], total;
+
+  success = 0;
+  for(i = 0; i < NCHILD; i++){
+    pid[i] = fork();
+    if(pid[i] < 0){
+      printf(2, "fork failed\n");
+      exit();
+    }
+    if(pid[i] == 0){
+      setaffinity(getpid(), 1);
+      for(;;)
+        ;
+    }
+    if(settickets(pid[i], 100 * (i + 1)) < 0){
+      printf(2, "FAILED: settickets(%d, %d) returned failure code\n",
+          pid[i], 100 * (i + 1));
+      success = -1;
+    }
+  }
+
+  sleep(RUNSECS * TPS);
+
+  table = malloc(NPROC * sizeof(struct uproc));
+  n = getprocs(NPROC, table);
+  total = 0;
+  for(i = 0; i < NCHILD; i++){
+    cpu[i] = 0;
+    for(j = 0; j < n; j++)
+      if(table[j].pid == pid[i])
+        cpu[i] = table[j].CPU_total_ticks;
+    total += cpu[i];
+  }
+  for(i = 0; i < NCHILD; i++){
+    got = total ? cpu[i] * 100 / total : 0;
+    want = 100 * (i + 1) / 6;
+    printf(1, "pid %d tickets %d cpu ticks %d (%d%%, expected %d%%)\n",
+        pid[i], gettickets(pid[i]), cpu[i], got, want);
+    if(got < want - TOLERANCE || got > want + TOLERANCE){
+      printf(2, "FAILED: pid %d got %d%% of the CPU, expected %d%% +/- %d%%\n",
+          pid[i], got, want, TOLERANCE);
+      success = -1;
+    }
+    kill(pid[i]);
+  }
+  if(success == 0)
+    printf(1, "** Test Passed! **\n");
+  for(i = 0; i < NCHILD; i++)
+    wait();
+  free(table);
+  exit();
+}
+
+#endif
@@ -22,6 +22,8 @@ fetchint(uint addr, int *ip)
 
   if(addr >= curproc->sz || addr+4 > curproc->sz)
     return -1;
+  if(uvmtouch(curproc, addr, 4) < 0)
+    return -1;
   *ip = *(int*)(addr);
   return 0;
 }
@@ -40,6 +42,9 @@ fetchstr(uint addr, char **pp)
   *pp = (char*)addr;
   ep = (char*)curproc->sz;
   for(s = *pp; s < ep; s++){
+    if((s == *pp || (uint)s % PGSIZE == 0) &&
+       uvmtouch(curproc, (uint)s, 1) < 0)
+      return -1;
     if(*s == 0)
       return s - *pp;
   }
@@ -66,6 +71,8 @@ argptr(int n, char **pp, int size)
     return -1;
   if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
     return -1;
+  if(uvmtouch(curproc, i, size) < 0)
+    return -1;
   *pp = (char*)i;
   return 0;
 }
@@ -121,9 +128,26 @@ extern int sys_setgid(void);
 extern int sys_getprocs(void);
 #endif
 
+#ifdef CS333_P3
+extern int sys_getprocsince(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_spawn(void);
+#endif
+
 #ifdef CS333_P4
 extern int sys_setpriority(void);
 extern int sys_getpriority(void);
+extern int sys_getschedlat(void);
+extern int sys_getcpustats(void);
+extern int sys_setaffinity(void);
+extern int sys_getaffinity(void);
+extern int sys_setrt(void);
+#endif
+
+#ifdef CS333_STRIDE
+extern int sys_settickets(void);
+extern int sys_gettickets(void);
 #endif
 
 static int (*syscalls[])(void) = {
@@ -165,10 +189,27 @@ static int (*syscalls[])(void) = {
 [SYS_getprocs] sys_getprocs,
 #endif
 
+#ifdef CS333_P3
+[SYS_getprocsince] sys_getprocsince,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_spawn]   sys_spawn,
+#endif
+
 
 #ifdef CS333_P4
 [SYS_setpriority] sys_setpriority,
 [SYS_getpriority] sys_getpriority,
+[SYS_getschedlat] sys_getschedlat,
+[SYS_getcpustats] sys_getcpustats,
+[SYS_setaffinity] sys_setaffinity,
+[SYS_getaffinity] sys_getaffinity,
+[SYS_setrt]   sys_setrt,
+#endif
+
+#ifdef CS333_STRIDE
+[SYS_settickets] sys_settickets,
+[SYS_gettickets] sys_gettickets,
 #endif
 
 };
@@ -212,9 +253,26 @@ static char *syscallnames[] = {
 	[SYS_getprocs] "getprocs",
 #endif
 
+#ifdef CS333_P3
+	[SYS_getprocsince] "getprocsince",
+	[SYS_clone]   "clone",
+	[SYS_join]    "join",
+	[SYS_spawn]   "spawn",
+#endif
+
 #ifdef CS333_P4
 	[SYS_setpriority] "setpriority",
 	[SYS_getpriority] "getpriority",
+	[SYS_getschedlat] "getschedlat",
+	[SYS_getcpustats] "getcpustats",
+	[SYS_setaffinity] "setaffinity",
+	[SYS_getaffinity] "getaffinity",
+	[SYS_setrt]   "setrt",
+#endif
+
+#ifdef CS333_STRIDE
+	[SYS_settickets] "settickets",
+	[SYS_gettickets] "gettickets",
 #endif
 
 };
@@ -30,4 +30,15 @@
 #define SYS_setgid  SYS_setuid+1
 #define SYS_getprocs SYS_setgid+1
 #define SYS_setpriority SYS_getprocs+1
-#define SYS_getpriority SYS_setpriority+1
\ No newline at end of file
+#define SYS_getpriority SYS_setpriority+1
+#define SYS_getschedlat SYS_getpriority+1
+#define SYS_getcpustats SYS_getschedlat+1
+#define SYS_setaffinity SYS_getcpustats+1
+#define SYS_getaffinity SYS_setaffinity+1
+#define SYS_settickets SYS_getaffinity+1
+#define SYS_gettickets SYS_settickets+1
+#define SYS_setrt SYS_gettickets+1
+#define SYS_getprocsince SYS_setrt+1
+#define SYS_clone   SYS_getprocsince+1
+#define SYS_join    SYS_clone+1
+#define SYS_spawn   SYS_join+1
\ No newline at end of file
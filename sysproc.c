@@ -9,6 +9,13 @@
 #ifdef PDX_XV6
 #include "pdx-kernel.h"
 #endif // PDX_XV6
+#ifdef CS333_P2
+#include "uproc.h"
+#endif
+#ifdef CS333_P4
+#include "schedlat.h"
+#include "cpustat.h"
+#endif
 
 int
 sys_fork(void)
@@ -64,6 +71,9 @@ sys_sleep(void)
 {
   int n;
   uint ticks0;
+#ifdef CS333_P3
+  int remaining;
+#endif // CS333_P3
 
   if(argint(0, &n) < 0)
     return -1;
@@ -72,7 +82,16 @@ sys_sleep(void)
     if(myproc()->killed){
       return -1;
     }
+#ifdef CS333_P3
+    // the timer wheel wakes us only once the deadline has passed.
+    // Read ticks once: 0 would mean no timeout.
+    remaining = n - (ticks - ticks0);
+    if(remaining <= 0)
+      break;
+    sleeptimeout(&ticks, (struct spinlock *)0, remaining);
+#else
     sleep(&ticks, (struct spinlock *)0);
+#endif // CS333_P3
   }
   return 0;
 }
@@ -158,7 +177,13 @@ sys_setuid(void)
 		return -1;	
 	}
 	else{
+#ifdef CS333_P3
+		procwritebegin(myproc());
+#endif
 		myproc()->uid = uid;
+#ifdef CS333_P3
+		procwriteend(myproc());
+#endif
 		return 0;
 	}
 
@@ -177,7 +202,13 @@ sys_setgid(void)
 		return -1;
 	}
 	else{
+#ifdef CS333_P3
+		procwritebegin(myproc());
+#endif
 		myproc()->gid = gid;
+#ifdef CS333_P3
+		procwriteend(myproc());
+#endif
 		return 0;
 	}
 
@@ -191,7 +222,7 @@ sys_getprocs(void)
 	struct uproc* table;
 	if(argint(0, &max)< 0)
 		return -1;
-	if(argptr(1, (void*)&table, sizeof(struct uproc*) * max) <0)
+	if(argptr(1, (void*)&table, sizeof(struct uproc) * max) <0)
 	{
 		return -1;
 	}
@@ -200,6 +231,47 @@ sys_getprocs(void)
 
 }
 
+#ifdef CS333_P3
+int
+sys_getprocsince(void)
+{
+	int max;
+	struct uproc *table;
+	uint *gen;
+
+	if(argint(0, &max) < 0)
+		return -1;
+	if(argptr(1, (void*)&table, sizeof(struct uproc) * max) < 0)
+		return -1;
+	if(argptr(2, (void*)&gen, sizeof(*gen)) < 0)
+		return -1;
+	return getprocsince(max, table, gen);
+}
+
+int
+sys_clone(void)
+{
+	int fn, arg;
+	char *stack;
+
+	if(argint(0, &fn) < 0 || argint(1, &arg) < 0)
+		return -1;
+	if(argptr(2, &stack, PGSIZE) < 0)
+		return -1;
+	return clone((void(*)(void*))fn, (void*)arg, stack);
+}
+
+int
+sys_join(void)
+{
+	void **stack;
+
+	if(argptr(0, (void*)&stack, sizeof(*stack)) < 0)
+		return -1;
+	return join(stack);
+}
+#endif
+
 
 #endif
 
@@ -212,7 +284,9 @@ sys_setpriority(void)
 	int priority;
 	if(argint(0, &pid)< 0)
 		return -1;
-	if(argint(1, &priority) < 0 || argint(1,&priority) > MAXPRIO)
+	if(argint(1, &priority) < 0)
+		return -1;
+	if(priority < 0 || priority > MAXPRIO)
 		return -1;
 	return setpriority(pid, priority);
 }
@@ -225,4 +299,92 @@ sys_getpriority(void)
 		return -1;
 	return getpriority(pid);
 }
+
+int
+sys_getschedlat(void)
+{
+	int pid;
+	struct schedlat *sl;
+	int n = 1;
+
+	if(argint(0, &pid) < 0)
+		return -1;
+	if(pid == 0)
+		n = MAXPRIO + 1;
+	if(argptr(1, (void*)&sl, sizeof(struct schedlat) * n) < 0)
+		return -1;
+	return getschedlat(pid, sl);
+}
+
+int
+sys_getcpustats(void)
+{
+	struct cpustats *st;
+
+	if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+		return -1;
+	return getcpustats(st);
+}
+
+int
+sys_setaffinity(void)
+{
+	int pid;
+	int mask;
+
+	if(argint(0, &pid) < 0)
+		return -1;
+	if(argint(1, &mask) < 0)
+		return -1;
+	return setaffinity(pid, mask);
+}
+
+int
+sys_getaffinity(void)
+{
+	int pid;
+	if(argint(0, &pid) < 0)
+		return -1;
+	return getaffinity(pid);
+}
+
+int
+sys_setrt(void)
+{
+	int pid;
+	int period;
+	int budget;
+
+	if(argint(0, &pid) < 0)
+		return -1;
+	if(argint(1, &period) < 0)
+		return -1;
+	if(argint(2, &budget) < 0)
+		return -1;
+	return setrt(pid, period, budget);
+}
+#endif
+
+#ifdef CS333_STRIDE
+int
+sys_settickets(void)
+{
+	int pid;
+	int tickets;
+
+	if(argint(0, &pid) < 0)
+		return -1;
+	if(argint(1, &tickets) < 0)
+		return -1;
+	return settickets(pid, tickets);
+}
+
+int
+sys_gettickets(void)
+{
+	int pid;
+	if(argint(0, &pid) < 0)
+		return -1;
+	return gettickets(pid);
+}
 #endif
\ No newline at end of file
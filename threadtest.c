@@ -0,0 +1,79 @@
+#ifdef CS333_P3
+
+#include "types.h"
+#include "user.h"
+#include "mmu.h"
+
+// This tests clone() and join().
+//
+// NTHREAD threads each fill their own slice of a shared array and
+// grow the shared heap; the creator joins them all and checks that
+// it sees every thread's writes.
+
+#define NTHREAD 4
+#define NSLOT 1000
+
+static int data[NTHREAD * NSLOT];
+static char *grown[NTHREAD];
+
+static void
+worker(void *arg)
+{
+  int id = (int)arg;
+  int i;
+
+  for(i = 0; i < NSLOT; i++)
+    data[id * NSLOT + i] = id + i;
+  grown[id] = sbrk(PGSIZE);
+  grown[id][0] = id;
+  exit();
+}
+
+int
+main(void)
+{
+  void *stack[NTHREAD], *st;
+  int pid[NTHREAD];
+  int i, j, failed = 0;
+
+  printf(1, "\n\nTesting clone() and join()...\n");
+  for(i = 0; i < NTHREAD; i++){
+    stack[i] = malloc(PGSIZE);
+    pid[i] = clone(worker, (void*)i, stack[i]);
+    if(pid[i] < 0){
+      printf(2, "clone returned failure code!\n");
+      printf(2, "**** TEST FAILED ****\n\n\n");
+      exit();
+    }
+  }
+  for(i = 0; i < NTHREAD; i++){
+    if(join(&st) < 0){
+      printf(2, "join returned failure code!\n");
+      failed = 1;
+    }
+  }
+  if(join(&st) != -1){
+    printf(2, "join with no threads left did not fail!\n");
+    failed = 1;
+  }
+  for(i = 0; i < NTHREAD; i++){
+    for(j = 0; j < NSLOT; j++)
+      if(data[i * NSLOT + j] != i + j){
+        printf(2, "thread %d write to slot %d lost\n", i, j);
+        failed = 1;
+        break;
+      }
+    if(grown[i] == 0 || grown[i][0] != i){
+      printf(2, "heap grown by thread %d not shared\n", i);
+      failed = 1;
+    }
+    free(stack[i]);
+  }
+  if(failed)
+    printf(2, "**** TEST FAILED ****\n\n\n");
+  else
+    printf(1, "**** TEST PASSED ****\n\n\n");
+  exit();
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifdef CS333_P4
+
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+#include "cpustat.h"
+
+// Print per-CPU utilization every second: top [count]
+// Busy% is the share of timer ticks that found a process running,
+// Intr% the share of time spent in interrupt handlers, and Ints the
+// number of interrupts taken.
+
+static void
+printload(uint load)
+{
+  uint frac = (load & (FIXED_1 - 1)) * 100 / FIXED_1;
+
+  printf(1, " %d.%d%d", load >> FSHIFT, frac / 10, frac % 10);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpustats prev, cur;
+  int count = 10;
+  int i, n;
+  uint busy, total, intr;
+
+  if(argc > 1)
+    count = atoi(argv[1]);
+  if(getcpustats(&prev) < 0){
+    printf(2, "top: getcpustats failed\n");
+    exit();
+  }
+  for(n = 0; n < count; n++){
+    sleep(TPS);
+    if(getcpustats(&cur) < 0){
+      printf(2, "top: getcpustats failed\n");
+      exit();
+    }
+    printf(1, "\nload average:");
+    for(i = 0; i < 3; i++)
+      printload(cur.load[i]);
+    printf(1, "\nCPU\tBusy%%\tIntr%%\tInts\tSwtch\tRunq\n");
+    for(i = 0; i < cur.ncpu; i++){
+      busy = cur.cpu[i].busy - prev.cpu[i].busy;
+      total = busy + cur.cpu[i].idle - prev.cpu[i].idle;
+      intr = cur.cpu[i].intr - prev.cpu[i].intr;
+      printf(1, "%d\t%d\t%d\t%d\t%d\t%d\n", i,
+          total ? busy * 100 / total : 0,
+          total ? (intr + 5 * total) / (10 * total) : 0,
+          cur.cpu[i].nintr - prev.cpu[i].nintr,
+          cur.cpu[i].nswtch - prev.cpu[i].nswtch,
+          cur.cpu[i].nready);
+    }
+    prev = cur;
+  }
+  exit();
+}
+
+#endif
@@ -54,12 +54,26 @@ trap(struct trapframe *tf)
     return;
   }
 
+#ifdef CS333_P4
+  uint tsc = 0;
+
+  // A T_WAKEUP IPI only ends a halt; it isn't interrupt work.
+  if(tf->trapno >= T_IRQ0)
+    mycpu()->nintr++;
+  if(tf->trapno >= T_IRQ0 && tf->trapno != T_WAKEUP)
+    tsc = rdtsc();
+#endif // CS333_P4
+
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
     if(cpuid() == 0){
 #ifdef PDX_XV6
       atom_inc((int *)&ticks);
+#ifdef CS333_P3
+      timertick();
+#else
       wakeup(&ticks);
+#endif // CS333_P3
 #else
       acquire(&tickslock);
       ticks++;
@@ -67,6 +81,10 @@ trap(struct trapframe *tf)
       release(&tickslock);
 #endif // PDX_XV6
     }
+#ifdef CS333_P4
+    cpustattick();
+    schedtick();
+#endif // CS333_P4
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
@@ -84,12 +102,28 @@ trap(struct trapframe *tf)
     uartintr();
     lapiceoi();
     break;
+#ifdef CS333_P4
+  case T_WAKEUP:
+    // Nothing to do; the halted scheduler() loop picks up the work.
+    lapiceoi();
+    break;
+#endif // CS333_P4
   case T_IRQ0 + 7:
   case T_IRQ0 + IRQ_SPURIOUS:
     cprintf("cpu%d: spurious interrupt at %x:%x\n",
             cpuid(), tf->cs, tf->eip);
     lapiceoi();
     break;
+  case T_PGFLT:
+    // Program and heap pages not touched yet, and writes to
+    // copy-on-write pages, from user code or from the kernel
+    // copying into user memory.  Anything else is fatal.
+    if(myproc() && (tf->err & 1) == 0 && rcr2() < myproc()->sz &&
+       lazyfault(myproc(), rcr2()) == 0)
+      break;
+    if(myproc() && (tf->err & 2) && cowfault(myproc()->pgdir, rcr2()) == 0)
+      break;
+    // fall through
 
   //PAGEBREAK: 13
   default:
@@ -106,6 +140,10 @@ trap(struct trapframe *tf)
             tf->err, cpuid(), tf->eip, rcr2());
     myproc()->killed = 1;
   }
+#ifdef CS333_P4
+  if(tf->trapno >= T_IRQ0 && tf->trapno != T_WAKEUP)
+    mycpu()->intrcycles += rdtsc() - tsc;
+#endif // CS333_P4
 
   // Force process exit if it has been killed and is in user space.
   // (If it is still executing in the kernel, let it keep running
@@ -116,7 +154,9 @@ trap(struct trapframe *tf)
   // Force process to give up CPU on clock tick.
   // If interrupts were on while locks held, would need to check nlock.
   if(myproc() && myproc()->state == RUNNING &&
-#ifdef PDX_XV6
+#ifdef CS333_P4
+    tf->trapno == T_IRQ0+IRQ_TIMER && mycpu()->resched)
+#elif defined(PDX_XV6)
     tf->trapno == T_IRQ0+IRQ_TIMER && ticks%SCHED_INTERVAL==0)
 #else
     tf->trapno == T_IRQ0+IRQ_TIMER)
@@ -0,0 +1,23 @@
+// Entry points of the user runtime library, _ulib.  The image
+// is linked at address 0 and starts with a table of their
+// addresses in this order (ulibtab.S); programs call them
+// through jump stubs that go through the table (ulibstub.S).
+// Only add entries at the end, so that programs linked against
+// an older library keep working with a newer one.
+
+ULIBFN(0, strcpy)
+ULIBFN(1, strcmp)
+ULIBFN(2, strlen)
+ULIBFN(3, memset)
+ULIBFN(4, strchr)
+ULIBFN(5, gets)
+ULIBFN(6, stat)
+ULIBFN(7, atoi)
+ULIBFN(8, memmove)
+ULIBFN(9, printf)
+ULIBFN(10, malloc)
+ULIBFN(11, free)
+#ifdef PDX_XV6
+ULIBFN(12, atoo)
+ULIBFN(13, strncmp)
+#endif // PDX_XV6
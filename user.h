@@ -1,6 +1,8 @@
 struct stat;
 struct rtcdate;
 struct uproc;
+struct schedlat;
+struct cpustats;
 
 // system calls
 int fork(void);
@@ -58,6 +60,27 @@ int setgid(uint);
 
 //get procs system call
 int getprocs(uint max, struct uproc* table);
+#ifdef CS333_P3
+int getprocsince(uint max, struct uproc* table, uint *gen);
+int clone(void (*fn)(void*), void *arg, void *stack);
+int join(void **stack);
+int spawn(char *path, char **argv, int *fdmap);
+#endif
 int ps(void);
 #endif
 
+#ifdef CS333_P4
+int setpriority(int pid, int priority);
+int getpriority(int pid);
+int getschedlat(int pid, struct schedlat *sl);
+int getcpustats(struct cpustats *st);
+int setaffinity(int pid, uint mask);
+int getaffinity(int pid);
+int setrt(int pid, int period, int budget);
+#endif
+
+#ifdef CS333_STRIDE
+int settickets(int pid, int tickets);
+int gettickets(int pid);
+#endif
+
@@ -6,8 +6,10 @@
 #include "mmu.h"
 #include "proc.h"
 #include "elf.h"
+#include "spinlock.h"
 
 extern char data[];  // defined by kernel.ld
+static struct spinlock faultlock;  // serializes user page faults
 pde_t *kpgdir;  // for use in scheduler()
 
 // Set up CPU's kernel segment descriptors.
@@ -114,7 +116,38 @@ static struct kmap {
  { (void*)DEVSPACE, DEVSPACE,      0,         PTE_W}, // more devices
 };
 
-// Set up kernel part of a page table.
+// Map size bytes at va to pa for the kernel, using 4MB
+// PTE_PS pages where both are 4MB aligned and 4KB pages
+// elsewhere.
+static int
+mapkernel(pde_t *pgdir, uint va, uint size, uint pa, int perm)
+{
+  pde_t *pde;
+  uint n;
+
+  while(size > 0){
+    if(va % PDSIZE == 0 && pa % PDSIZE == 0 && size >= PDSIZE){
+      pde = &pgdir[PDX(va)];
+      if(*pde & PTE_P)
+        panic("remap");
+      *pde = pa | perm | PTE_P | PTE_PS;
+      n = PDSIZE;
+    } else {
+      if(mappages(pgdir, (void*)va, PGSIZE, pa, perm) < 0)
+        return -1;
+      n = PGSIZE;
+    }
+    va += n;
+    pa += n;
+    size -= n;
+  }
+  return 0;
+}
+
+// Set up kernel part of a page table.  The kernel's mappings
+// never change once kpgdir is built, so other page tables
+// share its page directory entries, and with them its page
+// tables, rather than getting copies.
 pde_t*
 setupkvm(void)
 {
@@ -124,10 +157,15 @@ setupkvm(void)
   if((pgdir = (pde_t*)kalloc()) == 0)
     return 0;
   memset(pgdir, 0, PGSIZE);
+  if(kpgdir){
+    memmove(&pgdir[PDX(KERNBASE)], &kpgdir[PDX(KERNBASE)],
+            (NPDENTRIES - PDX(KERNBASE)) * sizeof(pde_t));
+    return pgdir;
+  }
   if (P2V(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
-    if(mappages(pgdir, k->virt, k->phys_end - k->phys_start,
+    if(mapkernel(pgdir, (uint)k->virt, k->phys_end - k->phys_start,
                 (uint)k->phys_start, k->perm) < 0) {
       freevm(pgdir);
       return 0;
@@ -142,6 +180,7 @@ kvmalloc(void)
 {
   kpgdir = setupkvm();
   switchkvm();
+  initlock(&faultlock, "fault");
 }
 
 // Switch h/w page table register to the kernel-only page table,
@@ -272,6 +311,8 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
         panic("kfree");
       char *v = P2V(pa);
       kfree(v);
+      if(*pte & PTE_COW)
+        pcacherelease(v);
       *pte = 0;
     }
   }
@@ -288,7 +329,8 @@ freevm(pde_t *pgdir)
   if(pgdir == 0)
     panic("freevm: no pgdir");
   deallocuvm(pgdir, KERNBASE, 0);
-  for(i = 0; i < NPDENTRIES; i++){
+  // The kernel half belongs to kpgdir; see setupkvm().
+  for(i = 0; i < PDX(KERNBASE); i++){
     if(pgdir[i] & PTE_P){
       char * v = P2V(PTE_ADDR(pgdir[i]));
       kfree(v);
@@ -311,9 +353,14 @@ clearpteu(pde_t *pgdir, char *uva)
 }
 
 // Given a parent process's page table, create a copy
-// of it for a child.
+// of it for a child.  If cow is set, pgdir must be the
+// current page table: the pages are shared read-only and
+// copied by cowfault() on the first write from either side.
+// Otherwise every page is copied now, which callers need
+// when other threads may still write through stale TLB
+// entries for pgdir.
 pde_t*
-copyuvm(pde_t *pgdir, uint sz)
+copyuvm(pde_t *pgdir, uint sz, int cow)
 {
   pde_t *d;
   pte_t *pte;
@@ -323,18 +370,32 @@ copyuvm(pde_t *pgdir, uint sz)
   if((d = setupkvm()) == 0)
     return 0;
   for(i = 0; i < sz; i += PGSIZE){
+    // Heap pages not touched yet are left for lazyfault().
     if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
+      continue;
     if(!(*pte & PTE_P))
-      panic("copyuvm: page not present");
+      continue;
     pa = PTE_ADDR(*pte);
+    if(cow){
+      if(*pte & PTE_W)
+        *pte = (*pte & ~PTE_W) | PTE_COW;
+      flags = PTE_FLAGS(*pte);
+      if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
+        goto bad;
+      kref((char*)P2V(pa));
+      continue;
+    }
     flags = PTE_FLAGS(*pte);
     if((mem = kalloc()) == 0)
       goto bad;
     memmove(mem, (char*)P2V(pa), PGSIZE);
-    if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0)
+    if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0){
+      kfree(mem);
       goto bad;
+    }
   }
+  if(cow)
+    lcr3(V2P(pgdir));  // flush the now read-only entries
   return d;
 
 bad:
@@ -342,6 +403,155 @@ bad:
   return 0;
 }
 
+// Hold off user page faults, e.g. while a process's size changes.
+void
+lockfaults(void)
+{
+  acquire(&faultlock);
+}
+
+void
+unlockfaults(void)
+{
+  release(&faultlock);
+}
+
+// Handle a write fault at va in pgdir.  If the page is
+// shared copy-on-write, give pgdir a private writable copy,
+// or just make it writable if nobody else shares it.
+// Return -1 if the fault was not a copy-on-write fault
+// or memory ran out.
+int
+cowfault(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  char *mem, *old;
+  int r;
+
+  if(va >= KERNBASE)
+    return -1;
+  pte = walkpgdir(pgdir, (void*)va, 0);
+  if(pte == 0 || (*pte & (PTE_P|PTE_U)) != (PTE_P|PTE_U))
+    return -1;
+
+  acquire(&faultlock);
+  r = 0;
+  old = 0;
+  if(*pte & PTE_W){
+    // Another thread got here first; our TLB entry was stale.
+  } else if(!(*pte & PTE_COW)){
+    r = -1;
+  } else {
+    old = (char*)P2V(PTE_ADDR(*pte));
+    if(krefcount(old) == 1){
+      *pte = (*pte | PTE_W) & ~PTE_COW;
+      old = 0;
+    } else if((mem = kalloc()) != 0){
+      memmove(mem, old, PGSIZE);
+      *pte = V2P(mem) | ((PTE_FLAGS(*pte) | PTE_W) & ~PTE_COW);
+      kfree(old);
+    } else {
+      r = -1;
+      old = 0;
+    }
+  }
+  release(&faultlock);
+  if(old)
+    pcacherelease(old);
+  if(r == 0 && myproc() && myproc()->pgdir == pgdir)
+    lcr3(V2P(pgdir));
+  return r;
+}
+
+// Make the page at va in p's address space present the first
+// time it is touched: program pages are read from their file, and
+// heap pages, which growproc() only counts in p->sz, are zero.
+// The caller checks va against the process size.  May sleep.
+// Return -1 if memory ran out or the read failed.
+int
+lazyfault(struct proc *p, uint va)
+{
+  pte_t *pte;
+  char *mem, *c;
+  struct seg *s;
+  uint n, off;
+  int shared, r;
+
+  if(va >= KERNBASE)
+    return -1;
+  va = PGROUNDDOWN(va);
+  pte = walkpgdir(p->pgdir, (char*)va, 0);
+  if(pte && (*pte & PTE_P))
+    return 0;
+  for(s = p->seg; s < &p->seg[NSEG]; s++)
+    if(va >= s->va && va - s->va < s->memsz)
+      break;
+  shared = 0;
+  if(s < &p->seg[NSEG] && va - s->va < s->filesz){
+    // Program pages are shared copy-on-write through the
+    // page cache, unless it is full.
+    off = s->off + (va - s->va);
+    n = s->filesz - (va - s->va);
+    if(n > PGSIZE)
+      n = PGSIZE;
+    shared = 1;
+    if((mem = pcacheget(s->ip, off, n)) == 0){
+      if((mem = kalloc()) == 0)
+        return -1;
+      memset(mem, 0, PGSIZE);
+      ilock(s->ip);
+      if(readi(s->ip, mem, off, n) != n){
+        iunlock(s->ip);
+        kfree(mem);
+        return -1;
+      }
+      // Still under the inode lock, so a writei() or itrunc()
+      // cannot invalidate the file between the read and the add.
+      if((c = pcacheadd(s->ip, off, n, mem)) != 0)
+        mem = c;
+      else
+        shared = 0;
+      iunlock(s->ip);
+    }
+  } else {
+    if((mem = kalloc()) == 0)
+      return -1;
+    memset(mem, 0, PGSIZE);
+  }
+
+  acquire(&faultlock);
+  pte = walkpgdir(p->pgdir, (char*)va, 0);
+  if(pte && (*pte & PTE_P))
+    r = 0;  // Another thread mapped it while we were reading.
+  else if(va >= p->sz)
+    r = -1;  // The process shrank while we were reading.
+  else if(mappages(p->pgdir, (char*)va, PGSIZE, V2P(mem),
+                   shared ? PTE_COW|PTE_U : PTE_W|PTE_U) < 0)
+    r = -1;
+  else {
+    release(&faultlock);
+    return 0;
+  }
+  release(&faultlock);
+  kfree(mem);
+  if(shared)
+    pcacherelease(mem);
+  return r;
+}
+
+// Make the user pages in [va, va+len) of p present, for the
+// kernel to use them directly.  The caller checks the bounds.
+int
+uvmtouch(struct proc *p, uint va, uint len)
+{
+  uint a;
+
+  for(a = PGROUNDDOWN(va); a < va + len; a += PGSIZE)
+    if(lazyfault(p, a) < 0)
+      return -1;
+  return 0;
+}
+
 //PAGEBREAK!
 // Map user virtual address to kernel address.
 char*
@@ -350,7 +560,7 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
@@ -360,15 +570,29 @@ uva2ka(pde_t *pgdir, char *uva)
 // Copy len bytes from p to user address va in page table pgdir.
 // Most useful when pgdir is not the current page table.
 // uva2ka ensures this only works for PTE_U pages.
+// Copy-on-write pages are copied first, since the kernel
+// writes them through its own mapping.  Pages of the current
+// process not touched yet are faulted in.  May sleep.
 int
 copyout(pde_t *pgdir, uint va, void *p, uint len)
 {
   char *buf, *pa0;
   uint n, va0;
+  pte_t *pte;
+  struct proc *curproc = myproc();
 
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
+    pte = walkpgdir(pgdir, (char*)va0, 0);
+    if((pte == 0 || !(*pte & PTE_P)) && curproc &&
+       curproc->pgdir == pgdir && va0 < curproc->sz){
+      if(lazyfault(curproc, va0) < 0)
+        return -1;
+      pte = walkpgdir(pgdir, (char*)va0, 0);
+    }
+    if(pte && (*pte & PTE_COW) && cowfault(pgdir, va0) < 0)
+      return -1;
     pa0 = uva2ka(pgdir, (char*)va0);
     if(pa0 == 0)
       return -1;
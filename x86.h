@@ -121,6 +121,17 @@ sti(void)
   asm volatile("sti");
 }
 
+// Atomically add v to *addr and return the old value.
+static inline ushort
+xaddw(volatile ushort *addr, ushort v)
+{
+  asm volatile("lock; xaddw %0, %1" :
+               "+r" (v), "+m" (*addr) :
+               :
+               "cc");
+  return v;
+}
+
 static inline uint
 xchg(volatile uint *addr, uint newval)
 {
@@ -134,6 +145,17 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+// Low 32 bits of the time-stamp counter; enough for intervals
+// of well under a second.
+static inline uint
+rdtsc(void)
+{
+  uint lo, hi;
+
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return lo;
+}
+
 static inline uint
 rcr2(void)
 {